@@ -7,6 +7,9 @@
 #ifndef __CF_H__
 #define __CF_H__
 
+#include <stddef.h>
+#include <stdio.h>
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -98,8 +101,32 @@ struct _cf_class {
      *
      * Returns a continued fraction of the same status with c, and
      * should be freed by `void (*free)(cf *c)'.
+     *
+     * A copy may share state with c: the homographic and bihomographic
+     * engines and the convergent generators move their inputs onto a
+     * tape shared by their copies, which changes c though it is const.
+     * So copying is not read-only: c and its copies are to be copied
+     * and read from one thread at a time.
      */
     cf * (*copy)(const cf * c);
+
+    /*
+     * Retrieve up to n next terms into buf at once (optional).
+     *
+     * Returns the number of terms retrieved, which is less than n only
+     * if the continued fraction is finished.  A class may leave it
+     * NULL, then `cf_next_terms()' pulls terms one by one.
+     */
+    size_t (*next_terms)(cf *c, long long *buf, size_t n);
+
+    /*
+     * Get ready to retrieve the next n terms (optional).
+     *
+     * A hint for the classes that work out their terms in batches, so
+     * that they work out n terms at once rather than a batch after
+     * another.  A class may leave it NULL.
+     */
+    void (*reserve)(cf *c, size_t n);
 };
 
 struct _cf {
@@ -133,10 +160,41 @@ struct _cf {
  *
  * The copy is made under the current status, and all terms have been
  * retrieved from the continued fraction are no more retrievable from
- * the new copy.
+ * the new copy.  It may change c, see `copy' of cf_class.
  */
 #define cf_copy(c)         cf_class(c)->copy(c)
 
+/*
+ * Retrieve up to n next terms from a continued fraction into buf.
+ *
+ * Uses the `next_terms' of the class if any, otherwise falls back to
+ * `next_term' until n terms are retrieved or the CF is finished.
+ *
+ * Returns the number of terms retrieved.
+ */
+size_t cf_next_terms(cf *c, long long *buf, size_t n);
+
+/*
+ * Let a continued fraction know that its next n terms are to be
+ * retrieved, by the `reserve' of the class if any.
+ */
+void cf_reserve_terms(cf *c, size_t n);
+
+/*
+ * Create a memoized continued fraction of x.
+ *
+ * The terms of x are recorded on a tape as they are retrieved, and the
+ * copies of the result are forks reading the same tape: a fork replays
+ * the terms already worked out and extends the tape when it gets ahead
+ * of the others.  Use it for a value taken more than once in an
+ * expression, as x in x * x + x, so that x is worked out once instead of
+ * once for every use; only the terms between the last fork and the
+ * first one are kept.
+ *
+ * Need to be freed by `cf_free()' helper macro.
+ */
+cf * cf_create_memo(const cf * x);
+
 /*
  * Compares two CF.
  *
@@ -171,6 +229,34 @@ int cf_compare(const cf * x, const cf * y);
 cf * cf_create_from_terms(const long long * terms,
                           unsigned int size);
 
+/*
+ * Create a continued fraction from terms, without copying them.
+ *
+ * The CF and its copies read the caller's array, which must stay alive
+ * and unchanged until all of them are freed.  Copies share the array and
+ * only have their own position, so they are cheap for any number of
+ * terms.  cf_create_from_terms() makes a single copy of the array, which
+ * is then shared in the same way.
+ */
+cf * cf_create_from_terms_borrowed(const long long * terms, size_t size);
+
+/*
+ * Create a continued fraction from terms in an array of malloc(), which
+ * is taken over: it is freed with the CF and the last of its copies, or
+ * at once if the CF can not be created.
+ */
+cf * cf_create_from_terms_owned(long long * terms, size_t size);
+
+/*
+ * Create a continued fraction from a file of terms as raw long long in
+ * the byte order of the machine, such as fwrite() of an array writes.
+ *
+ * The file is mapped into memory and never copied; the CF and its copies
+ * share the mapping.  Returns NULL if the file can not be mapped or its
+ * size is not a multiple of a term.
+ */
+cf * cf_create_from_terms_file(const char * path);
+
 /*
  * Create a continued fraction from terms of va-arg list as int type.
  */
@@ -195,9 +281,23 @@ cf * cf_create_from_fraction(fraction f);
 
 /*
  * Get gcd between two integers.
+ *
+ * The gcd is not negative, gcd(0, 0) is 0, but for a gcd of 2^63, which
+ * does not fit and is returned as LLONG_MIN: that is when each of a and b
+ * is 0 or LLONG_MIN, and not both are 0.
  */
 long long cf_get_gcd(long long a, long long b);
 
+/*
+ * Get gcd of each pair of integers, out[i] = gcd(a[i], b[i]) for i < n.
+ *
+ * Pairs are processed in parallel with AVX2 or AVX-512 where the cpu
+ * supports them.  The results are those of `cf_get_gcd()', LLONG_MIN
+ * for a gcd of 2^63.
+ */
+void cf_get_gcd_batch(const long long *a, const long long *b,
+                      long long *out, size_t n);
+
 /*
  * Create a continued fraction from a float point number.
  *
@@ -223,6 +323,60 @@ cf * cf_create_from_string_float(const char * float_str);
  */
 char * cf_convert_to_string_float(const cf *c, int max_digits);
 
+/*
+ * Sink of an output written in blocks.
+ *
+ * Receives the next `len' bytes of the output, not terminated by '\0'.
+ * Returns 0, or nonzero to stop the output.
+ */
+typedef int (*cf_sink)(const char *buf, size_t len, void *data);
+
+/*
+ * Write the decimal string of a CF to a sink.
+ *
+ * The output is the string of cf_convert_to_string_float_bulk(), given
+ * to the sink in blocks of a few kilobytes as the digits are converted,
+ * so the string is never held in memory as a whole.
+ *
+ * The memory is not bounded by the block, though: the value is worked
+ * out in integers of about as many digits as asked for, and with the
+ * temporaries of their division the peak is some 10 bytes a digit, 30 MB
+ * for 3 million digits of sqrt(2), besides the memory of the CF itself.
+ * The terms are read in chunks of a sixteenth of the digits, 4096 at
+ * least.  The digit generator, taken for CFs that are not canonical,
+ * keeps a few such integers too.
+ *
+ * Returns 0, or -1 if the sink fails.
+ */
+int cf_write_float_to(cf_sink sink, void *data, const cf *c, int max_digits);
+
+/*
+ * Write the decimal string of a CF to a file, by cf_write_float_to().
+ *
+ * Returns 0, or -1 if the file can not be written.
+ */
+int cf_write_float(FILE *f, const cf *c, int max_digits);
+
+/*
+ * Get decimal string from a CF, in bulk.
+ *
+ * The result is the same as cf_convert_to_string_float(), but the terms
+ * are retrieved in large batches and multiplied into the convergent by
+ * a balanced product tree, and the digits come from a single division
+ * and radix conversion of GMP.  The value is between the last
+ * convergent and its mediant with the one before, and more terms are
+ * retrieved until both share all the digits asked for, so the digits
+ * are always right.  This is much faster than the digit generator for
+ * many thousands of digits.
+ *
+ * The terms after the first are taken to be positive, as the terms of
+ * canonical CFs are; if a retrieved one is not, the CF is converted by
+ * cf_convert_to_string_float() instead.
+ *
+ * The returned string need to be freed.
+ */
+char * cf_convert_to_string_float_bulk(const cf *c, int max_digits);
+
 /*
  * Express CF as canonical string.
  *
@@ -230,6 +384,63 @@ char * cf_convert_to_string_float(const cf *c, int max_digits);
  */
 char * cf_convert_to_string_canonical(const cf *c, int max_terms);
 
+/*
+ * Write the canonical string of a CF to a sink.
+ *
+ * The output is the string of cf_convert_to_string_canonical(), given to
+ * the sink in blocks of a few kilobytes, so it is never held in memory as
+ * a whole.
+ *
+ * Returns 0, or -1 if the sink fails.
+ */
+int cf_write_canonical_to(cf_sink sink, void *data, const cf *c, int max_terms);
+
+/*
+ * Write the canonical string of a CF to a file, by cf_write_canonical_to().
+ *
+ * Returns 0, or -1 if the file can not be written.
+ */
+int cf_write_canonical(FILE *f, const cf *c, int max_terms);
+
+/*
+ * Write the terms of a CF to a sink in the binary format of term files,
+ * read back by cf_create_from_file():
+ *
+ *     "CFT1"          magic
+ *     a0              zigzag varint
+ *     a1 a2 ...       varints, the terms are positive
+ *     0 finished      a zero byte, and 1 if the CF ends here or 0 if it
+ *                     is cut at `max_terms'
+ *
+ * A varint is 7 bits a byte, low bits first, with the high bit set in
+ * all bytes but the last.  Most terms take a single byte.  The terms
+ * after the first must be positive, as in canonical CFs; the identity
+ * homographic of a CF makes them so.
+ *
+ * Returns 0, or -1 if the sink fails or a term is not positive.
+ */
+int cf_write_binary_to(cf_sink sink, void *data, const cf *c, size_t max_terms);
+
+/*
+ * Write the terms of a CF to a file, by cf_write_binary_to().
+ *
+ * Returns 0, or -1 if the file can not be written.
+ */
+int cf_write_binary(FILE *f, const cf *c, size_t max_terms);
+
+/*
+ * Create a continued fraction from a term file of cf_write_binary().
+ *
+ * The file is mapped into memory and its terms are decoded as they are
+ * retrieved, so it is never loaded as a whole.  Copies share the mapping.
+ * If is_complete is not NULL, it is set to 1 if the file holds all the
+ * terms of the CF, and to 0 if it was cut.  A damaged term ends the CF
+ * with LLONG_MAX.
+ *
+ * Returns NULL if the file can not be mapped or is not a term file.
+ */
+cf * cf_create_from_file(const char *path, int *is_complete);
+
 /*
  * Create a continued fraction from homograhic function of another
  * continued fraction.
@@ -321,6 +532,10 @@ cf * cf_create_from_homographic(const cf * x,
  *     cf = -----------------
  *          0xy + 0x + 1y + 0
  *
+ * The inner coefficients are kept in 64-bit integers while they fit, and
+ * are promoted to 128-bit integers and then to GMP integers when they
+ * overflow, up to 1024 bits. See cf_create_from_bihomographic_bits().
+ *
  * Need to be freed by `cf_free()' helper macro.
  */
 cf * cf_create_from_bihomographic(const cf * x, const cf * y,
@@ -329,19 +544,35 @@ cf * cf_create_from_bihomographic(const cf * x, const cf * y,
                                   long long e, long long f,
                                   long long g, long long h);
 
+/*
+ * Create a continued fraction from bihomograhic function, limiting the
+ * inner coefficients to `max_bits' bits (0 for unlimited).
+ *
+ * The coefficients are demoted to native integers again once they shrink
+ * after terms are output. When they would grow over the limit, a term is
+ * output ahead and the continued fraction may be ended early, so a value
+ * whose terms can never be decided (like pi / pi) still terminates.
+ *
+ * Need to be freed by `cf_free()' helper macro.
+ */
+cf * cf_create_from_bihomographic_bits(const cf * x, const cf * y,
+                                       long long a, long long b,
+                                       long long c, long long d,
+                                       long long e, long long f,
+                                       long long g, long long h,
+                                       unsigned max_bits);
+
 /*
  * Create a continued fraction from bihomograhic function with large
- * integers of precision greater than 64-bits.
+ * integers of a fixed precision.
  *
- * cf_create_from_bihomographic() function only use integers of
- * precision 63-bits to do inner calculates (plus one bit for sign to
- * gain 64-bits). It is often needs more bits to holds results of inner
- * calculations to gain more items of continued fraction which created
- * from a bihomograhic function.
+ * Unlike cf_create_from_bihomographic(), all the inner calculations are
+ * done in GMP integers of `precision' bits, even while the coefficients
+ * are small. The precision limits how many items of continued fraction
+ * can be gained from a bihomograhic function.
  *
- * For example to calculate sqrt( 3 / 13), using previous function to get:
- * [0 2 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12] with 21 items;
- * Using 64-bits precision to get 23 items:
+ * For example to calculate sqrt( 3 / 13),
+ * using 64-bits precision to get 23 items:
  * [0 2 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12 4 12 4 18];
  * Using 128-bits precision to get 45 items: [0 2 12 4 12 ... 4 12];
  * Using 256-bits precision to get 91 items: [0 2 12 4 12 ... 12 4 14];
@@ -357,7 +588,10 @@ cf * cf_create_from_bihomo_pre(const cf * x, const cf * y,
 /*
  * Create a CF which the value is `pi'.
  *
- * Implemented by using function `gcf_create_from_pi()'.
+ * pi is summed by the series of Chudnovsky with binary splitting, to a
+ * precision which is doubled whenever more terms are wanted, and the
+ * terms are those shared by the continued fractions of the bounds of
+ * the sum.  Millions of terms take seconds.
  *
  * Need to be freed by `cf_free()' helper macro.
  */
@@ -366,12 +600,46 @@ cf * cf_create_from_pi(void);
 /*
  * Create a CF which the value is sqrt(n)
  *
- * Implemented by using function `gcf_create_from_sqrt_n()'.
+ * The terms come from the periodic expansion of sqrt(n), by a recurrence
+ * of word-sized integers: each term costs a few operations and the
+ * state does not grow, however many terms are retrieved.  The copy is a
+ * copy of the state.
  *
  * Need to be freed by `cf_free()' helper macro.
  */
 cf * cf_create_from_sqrt_n(unsigned long long n);
 
+/*
+ * Create a CF which the value is (p + q sqrt(n)) / r. (r != 0)
+ *
+ * The terms come from the exact recurrence of the quadratic surd in
+ * native integers, like cf_create_from_sqrt_n(), and the copy is a copy
+ * of the state.  A value with a square n or with q = 0 is rational and
+ * gives a finite continued fraction.
+ *
+ * The integers hold surds of up to 62 bits after p, q and r are brought
+ * to a common form; larger ones are evaluated by a homographic function
+ * of sqrt(n) instead, which is slower and not periodic to
+ * `cf_get_period()'.
+ *
+ * Need to be freed by `cf_free()' helper macro.
+ */
+cf * cf_create_from_quadratic(long long p, long long q,
+                              unsigned long long n, long long r);
+
+/*
+ * Get the period of a periodic continued fraction.
+ *
+ * The terms from index `*pre_period' on repeat with a length of
+ * `*period'; for sqrt(n), *pre_period is 1.  A finite continued fraction
+ * (sqrt of a square) has a period of 0.  The period is worked out from
+ * the start of the continued fraction, whatever terms are retrieved.
+ *
+ * Returns 0, or -1 if c is not created by `cf_create_from_sqrt_n()' or
+ * `cf_create_from_quadratic()' as a periodic one.
+ */
+int cf_get_period(const cf *c, size_t *pre_period, size_t *period);
+
 /*
  * Create a CF which the value is v^{m/n}. (m < n)
  *
@@ -571,6 +839,44 @@ fraction rational_best_in(const cf* cf1, const cf* cf2);
  */
 fraction rational_best_for(const char * f);
 
+/*
+ * Calculate the best rational approximation of a CF with
+ * |numerator| <= maxnum and denominator <= maxden, the closest to it of
+ * all such fractions.  Of two as close, the one of smaller denominator
+ * is taken, or of smaller |numerator| if the denominators are the same:
+ * 5 / 2 and -5 / 2 give 2 / 1 and -2 / 1 for maxden 1, so the best for -x
+ * is always that for x negated.
+ *
+ * The semiconvergents are counted as well as the convergents: at the
+ * term where the convergents leave the bounds, the largest semiconvergent
+ * in them is worked out by a division, and compared to the convergent
+ * before it.  A query costs a step per term up to there, which is at most
+ * about 90 terms in long long.
+ *
+ * The terms are taken to be canonical, which they are but for those of
+ * the engines of negative values: if a term below 1 comes after a0, the
+ * value is expanded again in GMP integers, from the end of the CF or
+ * from its first 4096 terms, and the best is that of this expansion.
+ *
+ * maxden >= 1 and maxnum >= 0, or 0 / 0 is returned.
+ */
+fraction rational_best_with_bound(const cf * c, long long maxden,
+                                  long long maxnum);
+
+/*
+ * Calculate the best rationals with denominator <= maxden of n doubles,
+ * as `rational_best_with_bound()' does for their exact values, with the
+ * numerators in long long: a tie is decided by the same rule, and -2.5
+ * gives -2/1 for maxden 1.
+ *
+ * A double is m 2^e exactly, and its continued fraction is expanded
+ * from the bits in 128-bit integers, with no CF object nor allocation,
+ * so a value costs about a division per term up to the bound.  An
+ * infinity gives +-1/0, a NaN 0/0, and all values 0/0 if maxden < 1.
+ */
+void rational_best_batch(const double * in, fraction * out, size_t n,
+                         long long maxden);
+
 /*
  * add a digit to a canonical float string at a given location.
  *
@@ -625,6 +931,9 @@ struct _cf_digit_gen_class {
     /*
      * Make a copy of a CF generator for decimal.
      *
+     * The copy is made under the current status, and goes on with the
+     * digits after those retrieved from gen.
+     *
      * Returns a new CF generator for decimal, and should be freed by
      * `cf_free()' helper macro.
      */
@@ -648,6 +957,35 @@ struct _cf_digit_gen {
  */
 cf_digit_gen * cf_digit_gen_create_dec(const cf * c);
 
+/*
+ * Retrieve the next n digits of a decimal digit generator into buf, as
+ * characters '0' to '9' without a terminating '\0'.
+ *
+ * The first term of the generator, the integer part, should be
+ * retrieved by `cf_next_term()' before.  The digits are worked out 18
+ * at a time (9 where long has 32 bits), by one division of the scaled
+ * state for each chunk instead of one for each digit.
+ *
+ * Returns the number of digits written, less than n only if the
+ * generator is finished: the value ends there, and it has no trailing
+ * zeros.
+ */
+size_t cf_digit_gen_next_digits(cf_digit_gen *gen, char *buf, size_t n);
+
+/*
+ * Look at the next n digits of a decimal digit generator, as
+ * `cf_digit_gen_next_digits()' would retrieve them, without retrieving
+ * them: for a lookahead such as rounding.
+ *
+ * The digits are worked out on a copy of the generator, which shares
+ * the terms of the CF with it, so they are not worked out again when
+ * the generator goes on.
+ *
+ * Returns the number of digits written, which is less than n if the value
+ * ends, and 0 for a finished generator or an infinite value.
+ */
+size_t cf_digit_gen_peek_digits(const cf_digit_gen *gen, char *buf, size_t n);
+
 /*
  * CF Convergent Generator generates convergants for a CF.
  *
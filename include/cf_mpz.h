@@ -0,0 +1,154 @@
+/*
+ * Continued fractions from values in GMP integers.
+ *
+ * These functions need GMP, while cf.h does not, so they are declared
+ * in a separate header.
+ *
+ * \date   2026-10-17
+ */
+#ifndef __CF_MPZ_H__
+#define __CF_MPZ_H__
+
+#include <gmp.h>
+
+#include "cf.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * Create a continued fraction from the fraction n / d of GMP integers.
+ *
+ * d != 0.  The values are copied, n and d can be cleared after the call.
+ *
+ * The terms are extracted in batches: the partial quotients of the
+ * leading halves of the numbers are worked out recursively and applied
+ * to the full numbers at once, in the way of a half-gcd.  This gives a
+ * sub-quadratic cost over the whole expansion, so rationals of a
+ * million bits are expanded quickly.
+ *
+ * A term which does not fit in long long is returned as LLONG_MAX, and
+ * the continued fraction is finished after it.
+ *
+ * Need to be freed by `cf_free()' helper macro.
+ */
+cf * cf_create_from_mpz_fraction(mpz_srcptr n, mpz_srcptr d);
+
+/*
+ * Convergent Generator in GMP integers.
+ *
+ * It is the convergent generator of `cf_converg_gen_create()' without
+ * the bounds of long long: the convergents are exact whatever their
+ * size, so the convergents of long expansions such as sqrt(n) or pi can
+ * be walked to any term.
+ */
+typedef struct _cf_converg_mpz_gen cf_converg_mpz_gen;
+typedef struct _cf_converg_mpz_gen_class cf_converg_mpz_gen_class;
+
+/*
+ * Convergent p_k / q_k of the term a_k of a CF.
+ *
+ * The integers belong to the generator, and are valid until its next
+ * term is retrieved; they are not copied out, so a term costs only the
+ * two multiply-adds of the next convergent.  q_next is q_{k+1}, which
+ * bounds the error of a canonical CF:
+ *
+ *           1                                1
+ *     ----------------- < |x - p_k / q_k| < ----------- ,
+ *     q_k (q_k + q_k+1)                     q_k q_k+1
+ *
+ * worked out by `cf_converg_mpz_term_errors()' when it is needed.
+ */
+typedef struct _cf_converg_mpz_term {
+    long long coef;         /* a_k */
+    mpz_srcptr p, q;        /* the convergent */
+    mpz_srcptr q_next;      /* NULL if exact */
+    int exact;              /* the convergent is the value of the CF */
+} cf_converg_mpz_term;
+
+struct _cf_converg_mpz_gen_class {
+
+    /*
+     * Retrieve next convergent, NULL if finished.
+     */
+    const cf_converg_mpz_term * (*next_term)(cf_converg_mpz_gen * approx);
+
+    /*
+     * Check whether the approximation is finished.
+     */
+    int (*is_finished)(const cf_converg_mpz_gen * approx);
+
+    /*
+     * Need to be freed the approximation
+     */
+    void (*free)(cf_converg_mpz_gen * approx);
+
+    /*
+     * Make a new copy of this approximation, which goes on from it.
+     */
+    cf_converg_mpz_gen * (*copy)(const cf_converg_mpz_gen * approx);
+};
+
+struct _cf_converg_mpz_gen {
+    /* Class definition of a rational approximation of CF */
+    cf_converg_mpz_gen_class * object_class;
+};
+
+/*
+ * Create a rational approximation of CF in GMP integers.
+ *
+ * A term LLONG_MAX is taken as infinite, and the CF ends before it.
+ * After the first terms, the integers are reused from term to term, so
+ * that memory is only allocated as they grow.
+ *
+ * Need to be freed by `cf_free()' helper macro.
+ */
+cf_converg_mpz_gen * cf_converg_mpz_gen_create(const cf * c);
+
+/*
+ * The denominators of the lower and upper error bounds of a convergent,
+ * q_k (q_k + q_{k+1}) and q_k q_{k+1}, or 0 if it is exact.
+ */
+void cf_converg_mpz_term_errors(const cf_converg_mpz_term * term,
+                                mpz_t lower, mpz_t upper);
+
+/*
+ * The convergent p_k / q_k of the term a_k of a CF, at once.
+ *
+ * The terms up to a_k are retrieved and their matrices [a_i 1; 1 0]
+ * multiplied by a balanced product tree, so the cost is that of a few
+ * multiplications of numbers of the size of q_k, instead of k steps of
+ * `cf_converg_mpz_gen_create()': the millionth convergent of a CF takes
+ * seconds.  `cf_convergent_at_threads()' works out the subtrees on up to
+ * `threads' threads, for long expansions.
+ *
+ * A term LLONG_MAX is taken as infinite, and the CF ends before it.
+ * Returns 0, 1 if the CF ends before a_k and p / q is its value (1 / 0
+ * for a CF without terms), or -1 if it is out of memory.
+ */
+int cf_convergent_at(const cf * c, size_t k, mpz_t p, mpz_t q);
+int cf_convergent_at_threads(const cf * c, size_t k, mpz_t p, mpz_t q,
+                             int threads);
+
+/*
+ * All the convergents p_k / q_k of the n terms of an array, into p[k]
+ * and q[k], which are initialised by the caller.
+ *
+ * The terms are cut in chunks; the products of the matrices of the
+ * chunks are worked out in parallel, in long long while they fit, then
+ * the convergents at the ends of the chunks in order, and those inside
+ * the chunks in parallel again, on up to `threads' threads.  The terms
+ * are taken as they are, LLONG_MAX included.
+ *
+ * Returns 0, or -1 if it is out of memory.
+ */
+int cf_convergents_scan(const long long * terms, size_t n,
+                        mpz_t * p, mpz_t * q, int threads);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif // __CF_MPZ_H__
+/* vim:set tw=72: */
@@ -9,15 +9,24 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <limits.h>
 #include <gmp.h>
 
 #if defined (__cplusplus)
 extern "C" {
 #endif
 
+/*
+ * An integer is kept in `small' while it fits in int64_t (is_small is
+ * set), and in the mpz `value' otherwise. While is_small is set, the
+ * content of `value' is stale: it is only brought up to date when an
+ * operation has to fall back to GMP.
+ */
 typedef struct _integer {
     mpz_t value;
+    int64_t small;
     uint32_t precision;
+    bool is_small;
     bool infinite;
     bool overflow;
 } _integer_struct;
@@ -28,13 +37,75 @@ typedef _integer_struct *integer_ptr;
 void integer_config_precision ( uint32_t precision );
 uint32_t integer_get_config_precision ( void );
 
+static inline
+void integer_mpz_set_int64 ( mpz_t z, int64_t value )
+{
+    uint64_t u = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    mpz_import(z, 1, -1, sizeof(u), 0, 0, &u);
+    if (value < 0)
+        mpz_neg(z, z);
+}
+
+/* number of bits of |v| */
+static inline
+uint32_t integer_bits_int64 ( int64_t v )
+{
+    uint64_t u = v < 0 ? -(uint64_t)v : (uint64_t)v;
+    return u ? 64 - __builtin_clzll(u) : 0;
+}
+
+/* bring `value' up to date, and return it */
+static inline
+mpz_ptr integer_mpz ( integer_t n )
+{
+    if (n->is_small)
+        integer_mpz_set_int64(n->value, n->small);
+    return n->value;
+}
+
+/* move the mpz `value' of n back to `small' if it fits */
+static inline
+void integer_try_small ( integer_t n )
+{
+#if GMP_NUMB_BITS == 64 && GMP_NAIL_BITS == 0
+    if (mpz_size(n->value) <= 1)
+    {
+        mp_limb_t l = mpz_getlimbn(n->value, 0);
+        if (l <= (mp_limb_t)INT64_MAX)
+        {
+            n->small = mpz_sgn(n->value) < 0 ? -(int64_t)l : (int64_t)l;
+            n->is_small = true;
+            return;
+        }
+    }
+#else
+    if (mpz_sizeinbase(n->value, 2) <= 63)
+    {
+        uint64_t u = 0;
+        mpz_export(&u, 0, -1, sizeof(u), 0, 0, n->value);
+        n->small = mpz_sgn(n->value) < 0 ? -(int64_t)u : (int64_t)u;
+        n->is_small = true;
+        return;
+    }
+#endif
+    n->is_small = false;
+}
+
+static inline
+void integer_set_small ( integer_t n, int64_t value )
+{
+    n->small = value;
+    n->is_small = true;
+}
+
 static inline
 void integer_init2_with_int32(integer_t n, int32_t value, uint32_t precision)
 {
     n->precision = precision;
     n->infinite = false;
     n->overflow = false;
-    mpz_init_set_si(n->value, value);
+    mpz_init(n->value);
+    integer_set_small(n, value);
 }
 
 static inline
@@ -43,7 +114,8 @@ void integer_init2_with_uint32(integer_t n, uint32_t value, uint32_t precision)
     n->precision = precision;
     n->infinite = false;
     n->overflow = false;
-    mpz_init_set_ui(n->value, value);
+    mpz_init(n->value);
+    integer_set_small(n, value);
 }
 
 static inline
@@ -53,16 +125,7 @@ void integer_init2_with_int64(integer_t n, int64_t value, uint32_t precision)
     n->infinite = false;
     n->overflow = false;
     mpz_init(n->value);
-    if (value < 0)
-    {
-        value = -value;
-        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
-        mpz_neg(n->value, n->value);
-    }
-    else
-    {
-        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
-    }
+    integer_set_small(n, value);
 }
 
 static inline
@@ -72,7 +135,15 @@ void integer_init2_with_uint64(integer_t n, uint64_t value, uint32_t precision)
     n->infinite = false;
     n->overflow = false;
     mpz_init(n->value);
-    mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
+    if (value <= (uint64_t)INT64_MAX)
+    {
+        integer_set_small(n, (int64_t)value);
+    }
+    else
+    {
+        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
+        n->is_small = false;
+    }
 }
 
 static inline 
@@ -130,13 +201,26 @@ bool integer_is_infinite ( integer_t n )
 static inline
 bool integer_is_overflow ( integer_t n )
 {
-    return n->overflow || mpz_sizeinbase(n->value, 2) > n->precision;
+    size_t limbs;
+
+    if (n->overflow)
+        return true;
+    if (n->is_small)
+        return n->precision < 63 && integer_bits_int64(n->small) > n->precision;
+
+    /* count the limbs first, only look at the bits near the boundary */
+    limbs = mpz_size(n->value);
+    if (limbs * GMP_NUMB_BITS <= n->precision)
+        return false;
+    if ((limbs - 1) * GMP_NUMB_BITS >= n->precision)
+        return true;
+    return mpz_sizeinbase(n->value, 2) > n->precision;
 }
 
 static inline
 bool integer_is_zero ( integer_t n )
 {
-    return mpz_sgn(n->value) == 0;
+    return n->is_small ? n->small == 0 : mpz_sgn(n->value) == 0;
 }
 
 static inline
@@ -150,10 +234,12 @@ int integer_cmp ( integer_t a, integer_t b )
         return -2;
     else if (integer_is_overflow(b))
         return -2;
+    else if (a->is_small && b->is_small)
+        return a->small > b->small ? 1 : a->small < b->small ? -1 : 0;
     else
     {
         int i;
-        i = mpz_cmp(a->value, b->value);
+        i = mpz_cmp(integer_mpz(a), integer_mpz(b));
         return i > 0 ? 1 : i < 0 ? -1 : 0;
     }
 }
@@ -167,6 +253,8 @@ bool integer_equals ( integer_t a, integer_t b )
 static inline
 int32_t integer_sgn ( integer_t n )
 {
+    if (n->is_small)
+        return n->small > 0 ? 1 : n->small < 0 ? -1 : 0;
     return mpz_sgn(n->value);
 }
 
@@ -175,7 +263,17 @@ void integer_set ( integer_t dest, integer_t a )
 {
     dest->infinite = a->infinite;
     dest->overflow = a->overflow;
-    mpz_set(dest->value, a->value);
+    if (dest == a)
+        return;
+    if (a->is_small)
+    {
+        integer_set_small(dest, a->small);
+    }
+    else
+    {
+        mpz_set(dest->value, a->value);
+        dest->is_small = false;
+    }
 }
 
 static inline
@@ -183,7 +281,7 @@ void integer_set_int32 ( integer_t dest, int32_t i )
 {
     dest->infinite = false;
     dest->overflow = false;
-    mpz_set_si(dest->value, i);
+    integer_set_small(dest, i);
 }
 
 static inline
@@ -191,16 +289,7 @@ void integer_set_int64(integer_t n, int64_t value)
 {
     n->infinite = false;
     n->overflow = false;
-    if (value < 0)
-    {
-        value = -value;
-        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
-        mpz_neg(n->value, n->value);
-    }
-    else
-    {
-        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
-    }
+    integer_set_small(n, value);
 }
 
 static inline
@@ -208,7 +297,15 @@ void integer_set_uint64(integer_t n, uint64_t value)
 {
     n->infinite = false;
     n->overflow = false;
-    mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
+    if (value <= (uint64_t)INT64_MAX)
+    {
+        integer_set_small(n, (int64_t)value);
+    }
+    else
+    {
+        mpz_import(n->value, 1, -1, sizeof(value), 0, 0, &value);
+        n->is_small = false;
+    }
 }
 
 static inline
@@ -217,7 +314,15 @@ void integer_neg ( integer_t dest, integer_t a )
     dest->infinite = a->infinite;
     dest->overflow = integer_is_overflow(a);
     if (!dest->infinite)
-        mpz_neg(dest->value, a->value);
+    {
+        if (a->is_small && a->small != INT64_MIN)
+        {
+            integer_set_small(dest, -a->small);
+            return;
+        }
+        mpz_neg(dest->value, integer_mpz(a));
+        integer_try_small(dest);
+    }
 }
 
 static inline
@@ -226,7 +331,17 @@ void integer_add ( integer_t dest, integer_t a, integer_t b )
     dest->infinite = a->infinite || b->infinite;
     dest->overflow = integer_is_overflow(a) || integer_is_overflow(b);
     if (!dest->infinite && !dest->overflow)
-        mpz_add(dest->value, a->value, b->value);
+    {
+        int64_t r;
+        if (a->is_small && b->is_small &&
+            !__builtin_add_overflow(a->small, b->small, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
+        mpz_add(dest->value, integer_mpz(a), integer_mpz(b));
+        integer_try_small(dest);
+    }
 }
 
 static inline
@@ -235,7 +350,17 @@ void integer_sub ( integer_t dest, integer_t a, integer_t b )
     dest->infinite = a->infinite || b->infinite;
     dest->overflow = integer_is_overflow(a) || integer_is_overflow(b);
     if (!dest->infinite && !dest->overflow)
-        mpz_sub(dest->value, a->value, b->value);
+    {
+        int64_t r;
+        if (a->is_small && b->is_small &&
+            !__builtin_sub_overflow(a->small, b->small, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
+        mpz_sub(dest->value, integer_mpz(a), integer_mpz(b));
+        integer_try_small(dest);
+    }
 }
 
 static inline
@@ -244,16 +369,45 @@ void integer_mul ( integer_t dest, integer_t a, integer_t b )
     dest->infinite = a->infinite || b->infinite;
     dest->overflow = integer_is_overflow(a) || integer_is_overflow(b);
     if (!dest->infinite && !dest->overflow)
-        mpz_mul(dest->value, a->value, b->value);
+    {
+        int64_t r;
+        if (a->is_small && b->is_small &&
+            !__builtin_mul_overflow(a->small, b->small, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
+        mpz_mul(dest->value, integer_mpz(a), integer_mpz(b));
+        integer_try_small(dest);
+    }
+}
+
+/* quotient of a / b rounded towards -infinity, like mpz_fdiv_q() */
+static inline
+int64_t integer_fdiv_int64 ( int64_t a, int64_t b )
+{
+    int64_t q = a / b;
+    if (a % b != 0 && ((a < 0) != (b < 0)))
+        --q;
+    return q;
 }
 
 static inline
 void integer_div ( integer_t dest, integer_t a, integer_t b )
 {
-    dest->infinite = a->infinite || b->infinite || mpz_sgn(b->value) == 0;
+    dest->infinite = a->infinite || b->infinite || integer_is_zero(b);
     dest->overflow = integer_is_overflow(a) || integer_is_overflow(b);
     if (!dest->infinite && !dest->overflow)
-        mpz_div(dest->value, a->value, b->value);
+    {
+        if (a->is_small && b->is_small &&
+            !(a->small == INT64_MIN && b->small == -1))
+        {
+            integer_set_small(dest, integer_fdiv_int64(a->small, b->small));
+            return;
+        }
+        mpz_div(dest->value, integer_mpz(a), integer_mpz(b));
+        integer_try_small(dest);
+    }
 }
 
 static inline
@@ -263,12 +417,19 @@ void integer_add_int32 ( integer_t dest, integer_t a, int32_t i )
     dest->overflow = integer_is_overflow(a);
     if (!dest->infinite && !dest->overflow)
     {
+        int64_t r;
+        if (a->is_small && !__builtin_add_overflow(a->small, (int64_t)i, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
         if (i > 0)
-            mpz_add_ui(dest->value, a->value, (uint32_t)i);
+            mpz_add_ui(dest->value, integer_mpz(a), (uint32_t)i);
         else if (i < 0)
-            mpz_sub_ui(dest->value, a->value, (uint32_t)(-i));
+            mpz_sub_ui(dest->value, integer_mpz(a), -(uint32_t)i);
         else
-            mpz_set(dest->value, a->value);
+            mpz_set(dest->value, integer_mpz(a));
+        integer_try_small(dest);
     }
 }
 
@@ -279,53 +440,38 @@ void integer_sub_int32 ( integer_t dest, integer_t a, int32_t i )
     dest->overflow = integer_is_overflow(a);
     if (!dest->infinite && !dest->overflow)
     {
+        int64_t r;
+        if (a->is_small && !__builtin_sub_overflow(a->small, (int64_t)i, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
         if (i > 0)
-            mpz_sub_ui(dest->value, a->value, (uint32_t)i);
+            mpz_sub_ui(dest->value, integer_mpz(a), (uint32_t)i);
         else if (i < 0)
-            mpz_add_ui(dest->value, a->value, (uint32_t)(-i));
+            mpz_add_ui(dest->value, integer_mpz(a), -(uint32_t)i);
         else
-            mpz_set(dest->value, a->value);
+            mpz_set(dest->value, integer_mpz(a));
+        integer_try_small(dest);
     }
 }
 
 static inline
 void integer_inc ( integer_t dest, int32_t i )
 {
-    mpz_t x;
-    mpz_init(x);
     if (!dest->infinite && !dest->overflow)
     {
-        if (i >= 0)
-        {
-            mpz_add_ui(x, dest->value, (uint32_t)i);
-        }
-        else if (i < 0)
-        {
-            mpz_sub_ui(x, dest->value, (uint32_t)(-i));
-        }
-        mpz_set(dest->value, x);
+        integer_add_int32(dest, dest, i);
     }
-    mpz_clear(x);
 }
 
 static inline
 void integer_dec ( integer_t dest, int32_t i )
 {
-    mpz_t x;
-    mpz_init(x);
     if (!dest->infinite && !dest->overflow)
     {
-        if (i >= 0)
-        {
-            mpz_sub_ui(x, dest->value, (uint32_t)i);
-        }
-        else if (i < 0)
-        {
-            mpz_add_ui(x, dest->value, (uint32_t)(-i));
-        }
-        mpz_set(dest->value, x);
+        integer_sub_int32(dest, dest, i);
     }
-    mpz_clear(x);
 }
 
 static inline
@@ -334,7 +480,16 @@ void integer_mul_int32 ( integer_t dest, integer_t a, int32_t i )
     dest->infinite = a->infinite;
     dest->overflow = integer_is_overflow(a);
     if (!dest->infinite && !dest->overflow)
-        mpz_mul_si(dest->value, a->value, i);
+    {
+        int64_t r;
+        if (a->is_small && !__builtin_mul_overflow(a->small, (int64_t)i, &r))
+        {
+            integer_set_small(dest, r);
+            return;
+        }
+        mpz_mul_si(dest->value, integer_mpz(a), i);
+        integer_try_small(dest);
+    }
 }
 
 static inline
@@ -344,60 +499,45 @@ void integer_div_int32 ( integer_t dest, integer_t a, int32_t i )
     dest->overflow = integer_is_overflow(a);
     if (!dest->infinite && !dest->overflow)
     {
-        if (i > 0)
-            mpz_div_ui(dest->value, a->value, (uint32_t)i);
-        else
-            mpz_div_ui(dest->value, a->value, (uint32_t)(-i));
+        /* divided by |i| */
+        uint32_t u = i > 0 ? (uint32_t)i : -(uint32_t)i;
+        if (a->is_small)
+        {
+            integer_set_small(dest, integer_fdiv_int64(a->small, (int64_t)u));
+            return;
+        }
+        mpz_div_ui(dest->value, a->value, u);
+        integer_try_small(dest);
     }
 }
 
 static inline
 int64_t integer_get_int64 ( integer_t n )
 {
-    uint64_t result = 0;
-    size_t bytes;
     if (n->infinite || integer_is_overflow(n))
     {
-        if (mpz_sgn(n->value) >= 0)
+        if (integer_sgn(n) >= 0)
             return LLONG_MAX;
         else
             return LLONG_MIN;
     }
-    switch (mpz_sgn(n->value))
-    {
-    case 0:
-        return 0ll;
-    case -1:
-        bytes = (mpz_sizeinbase(n->value, 16) + 1) / 2;
-        if (sizeof(result) > bytes)
-        {
-            mpz_export(&result, 0, -1, sizeof(result), 0, 0, n->value);
-            return -result;
-        }
-        else
-            return LLONG_MIN;
-    default:
-        bytes = (mpz_sizeinbase(n->value, 16) + 1) / 2;
-        if (sizeof(result) > bytes)
-        {
-            mpz_export(&result, 0, -1, sizeof(result), 0, 0, n->value);
-            return result;
-        }
-        else return LLONG_MAX;
-    }
+    if (n->is_small)
+        return n->small;
+    /* a value in the mpz form does not fit in int64_t */
+    return mpz_sgn(n->value) >= 0 ? LLONG_MAX : LLONG_MIN;
 }
 
 static inline
 uint64_t integer_get_uint64 ( integer_t n )
 {
     uint64_t result = 0;
-    size_t bytes;
     if (n->infinite || integer_is_overflow(n))
     {
         return ULLONG_MAX;
     }
-    bytes = (mpz_sizeinbase(n->value, 16) + 1) / 2;
-    if (sizeof(result) > bytes)
+    if (n->is_small)
+        return (uint64_t)n->small;
+    if (mpz_sizeinbase(n->value, 2) <= 64)
     {
         mpz_export(&result, 0, -1, sizeof(result), 0, 0, n->value);
         return result;
@@ -415,11 +555,16 @@ void integer_diff ( integer_t dest, integer_t a, integer_t b )
     dest->overflow = integer_is_overflow(a) || integer_is_overflow(b);
     if (!dest->infinite && !dest->overflow)
     {
-        mpz_t x;
-        mpz_init(x);
-        mpz_sub(x, a->value, b->value);
-        mpz_abs(dest->value, x);
-        mpz_clear(x);
+        int64_t r;
+        if (a->is_small && b->is_small &&
+            !__builtin_sub_overflow(a->small, b->small, &r) && r != INT64_MIN)
+        {
+            integer_set_small(dest, r < 0 ? -r : r);
+            return;
+        }
+        mpz_sub(dest->value, integer_mpz(a), integer_mpz(b));
+        mpz_abs(dest->value, dest->value);
+        integer_try_small(dest);
     }
 }
 
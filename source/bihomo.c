@@ -5,15 +5,33 @@
 
 #include "cf.h"
 #include "common.h"
-#include "integer.h"
+#include "coefs.h"
 
 static cf_class _bihomographic_class;
 
+/*
+ * (axy + bx + cy + d) / (exy + fx + gy + h), with a..h kept in k[0..7].
+ * The coefficients start as long long and are promoted on overflow by
+ * coefs, up to max_bits.
+ */
+enum { BA, BB, BC, BD, BE, BF, BG, BH };
+
+static const coefs_pair _bihomo_ingest_x[4] = {{BA, BC}, {BB, BD},
+                                               {BE, BG}, {BF, BH}};
+static const coefs_pair _bihomo_ingest_y[4] = {{BA, BB}, {BC, BD},
+                                               {BE, BF}, {BG, BH}};
+static const coefs_pair _bihomo_emit[4] = {{BE, BA}, {BF, BB},
+                                           {BG, BC}, {BH, BD}};
+
+/* default limit of coefficients for cf_create_from_bihomographic() */
+#define BIHOMO_DEFAULT_BITS 1024
+
 typedef struct _bihomographic bihomographic;
 struct _bihomographic {
     cf base;
-    long long a, b, c, d, e, f, g, h;
+    coefs k;
     cf * x, * y;
+    cf_term_block xb, yb;
 };
 
 static long long diff(long long x, long long y)
@@ -26,30 +44,50 @@ static long long max(long long x, long long y)
     return x > y ? x : y;
 }
 
-/* macro detect_overflow(is_overflow) */
-#if defined(__GNUC__) && defined(i386)
-#define detect_overflow(is_overflow)                         \
-{                                                            \
-    size_t eflags;                                           \
-	__asm__ (                                                \
-		"pushfl;"                                            \
-		"popl %%eax"                                         \
-      : "=a" (eflags));                                      \
-    is_overflow |= (eflags >> 11) & 1;                       \
+static int bihomographic_done(const bihomographic *bh)
+{
+    return coefs_is_zero(&bh->k, BE) && coefs_is_zero(&bh->k, BF) &&
+           coefs_is_zero(&bh->k, BG) && coefs_is_zero(&bh->k, BH);
 }
-#elif defined(__GNUC__) && defined(__x86_64__)
-#define detect_overflow(is_overflow)                         \
-{                                                            \
-    size_t rflags;                                           \
-	__asm__ (                                                \
-		"pushfq;"                                            \
-		"popq %%rax"                                         \
-      : "=a" (rflags));                                      \
-    is_overflow |= (rflags >> 11) & 1;                       \
+
+static void bihomographic_finish(bihomographic *bh)
+{
+    coefs_zero(&bh->k, BE);
+    coefs_zero(&bh->k, BF);
+    coefs_zero(&bh->k, BG);
+    coefs_zero(&bh->k, BH);
+}
+
+static long long bihomographic_quot(bihomographic *bh, int i, int j, int *exact)
+{
+    *exact = 1;
+    return coefs_is_zero(&bh->k, j) ? LLONG_MAX
+                                    : coefs_quot(&bh->k, i, j, exact);
+}
+
+/*
+ * Ingest the term p by the steps, and if the coefficients would exceed
+ * the limit of bits, output a term ahead as well as it can be guessed.
+ */
+static int bihomographic_ingest(bihomographic *bh, const coefs_pair *pairs,
+                                long long p, long long *ret)
+{
+    int exact;
+
+    if (coefs_step(&bh->k, pairs, 4, p) == 0)
+        return 0;
+
+    /* pre-output */
+    *ret = max( bihomographic_quot(bh, BA, BE, &exact),
+                max( bihomographic_quot(bh, BB, BF, &exact),
+                     bihomographic_quot(bh, BC, BG, &exact) ) );
+    if (coefs_step_sub(&bh->k, _bihomo_emit, 4, *ret) != 0 ||
+        coefs_step(&bh->k, pairs, 4, p) != 0)
+    {
+        bihomographic_finish(bh);
+    }
+    return 1;
 }
-#else
-#error detect_overflow() not implemented!
-#endif
 
 static long long bihomographic_next_term(cf *c)
 {
@@ -62,67 +100,56 @@ static long long bihomographic_next_term(cf *c)
     {
         int input_x;
 
-        if (bh->e == 0 && bh->f == 0 && bh->g == 0 && bh->h == 0) 
+        if (bihomographic_done(bh))
         {
             return LLONG_MAX;
         }
 
         do {
+            int exy, ex, ey, e0;
 
-            if (bh->f == 0)
+            if (coefs_is_zero(&bh->k, BF))
             {
-                input_x = (bh->e == 0);
+                input_x = coefs_is_zero(&bh->k, BE);
                 break;
             }
-            ix  = bh->b / bh->f;
+            ix  = coefs_quot(&bh->k, BB, BF, &ex);
 
-            if (bh->g == 0)
+            if (coefs_is_zero(&bh->k, BG))
             {
-                input_x = (bh->e != 0);
+                input_x = !coefs_is_zero(&bh->k, BE);
                 break;
             }
-            iy  = bh->c / bh->g;
+            iy  = coefs_quot(&bh->k, BC, BG, &ey);
 
-            ixy = bh->e ? bh->a / bh->e : LLONG_MAX;
-            i0  = bh->h ? bh->d / bh->h : LLONG_MAX;
+            ixy = bihomographic_quot(bh, BA, BE, &exy);
+            i0  = bihomographic_quot(bh, BD, BH, &e0);
 
-            if (ixy == ix && ix == iy && iy == i0)
+            if (ixy == ix && ix == iy && iy == i0 &&
+                exy && ex && ey && e0)
             {
                 /* output a term */
-                long long a, b, c, d, e, f, g, h;
-                int is_overflow = 0;
-
                 if (ixy < 0)
                 {
                     --ixy;
                 }
 
-                    a = bh->a;      b = bh->b;      c = bh->c;      d = bh->d;
-                bh->a = bh->e;  bh->b = bh->f;  bh->c = bh->g;  bh->d = bh->h;
-
-                e = ixy * bh->e;     detect_overflow(is_overflow);
-                f = ixy * bh->f;     detect_overflow(is_overflow);
-                g = ixy * bh->g;     detect_overflow(is_overflow);
-                h = ixy * bh->h;     detect_overflow(is_overflow);
-
-                if (is_overflow)
-                {
-                    bh->e = 0;
-                    bh->f = 0;
-                    bh->g = 0;
-                    bh->h = 0;
-                }
-                else
-                {
-                    bh->e = a - e;
-                    bh->f = b - f;
-                    bh->g = c - g;
-                    bh->h = d - h;
-                }
+                if (coefs_step_sub(&bh->k, _bihomo_emit, 4, ixy) != 0)
+                    bihomographic_finish(bh);
+                else if (bh->k.tier != COEFS_TIER_LL)
+                    coefs_demote(&bh->k);
 
                 return ixy;
             }
 
+            if (ixy == ix && ix == iy && iy == i0 &&
+                !exy && !ex && !ey && !e0)
+            {
+                /* the term does not fit in long long */
+                bihomographic_finish(bh);
+                return LLONG_MAX;
+            }
+
             if (ixy == ix && ix != 0)
             {
                 input_x = 1;
@@ -135,13 +162,13 @@ static long long bihomographic_next_term(cf *c)
                 break;
             }
 
-            if (bh->h == 0)
+            if (coefs_is_zero(&bh->k, BH))
             {
                 input_x = diff(ixy, iy) > diff(ixy, ix) ? 1 : 0;
                 break;
             }
 
-            if (bh->e == 0)
+            if (coefs_is_zero(&bh->k, BE))
             {
                 input_x = diff(i0, iy) > diff(i0, ix) ? 1 : 0;
                 break;
@@ -152,250 +179,58 @@ static long long bihomographic_next_term(cf *c)
 
         if (input_x)
         {
-            long long p;
+            long long p, ret;
 
-            p = cf_next_term(bh->x);
-            if (p == LLONG_MAX && cf_is_finished(bh->x))
+            p = cf_term_block_next(&bh->xb, bh->x);
+            if (p == LLONG_MAX && cf_term_block_is_finished(&bh->xb, bh->x))
             {
-                bh->c = bh->a;
-                bh->d = bh->b;
-                bh->g = bh->e;
-                bh->h = bh->f;
+                coefs_set(&bh->k, BC, BA);
+                coefs_set(&bh->k, BD, BB);
+                coefs_set(&bh->k, BG, BE);
+                coefs_set(&bh->k, BH, BF);
             }
-            else
+            else if (bihomographic_ingest(bh, _bihomo_ingest_x, p, &ret))
             {
-                long long a = bh->a, b = bh->b, c, d, e = bh->e, f = bh->f, g, h;
-                long long A, B, C, D, E, F, G, H;
-                long long t1, t2, t3, t4;
-                int is_overflow = 0;
-
-                t1 = a * p;         detect_overflow(is_overflow);
-                t2 = b * p;         detect_overflow(is_overflow);
-                t3 = e * p;         detect_overflow(is_overflow);
-                t4 = f * p;         detect_overflow(is_overflow);
-                
-                A = t1 + bh->c;     detect_overflow(is_overflow);
-                B = t2 + bh->d;     detect_overflow(is_overflow);
-                C = a;
-                D = b;
-
-                E = t3 + bh->g;     detect_overflow(is_overflow);
-                F = t4 + bh->h;     detect_overflow(is_overflow);
-                G = e;
-                H = f;
-
-                if (is_overflow) /* {{{ handle overflow exception */
-                {
-                    long long ret = max( bh->e ? bh->a / bh->e : LLONG_MAX ,
-                                         max ( bh->f ? bh->b / bh->f : LLONG_MAX,
-                                               bh->g ? bh->c / bh->g : LLONG_MAX ) );
-                    // pre-output
-                    {
-                            a = bh->a;      b = bh->b;      c = bh->c;      d = bh->d;
-                        bh->a = bh->e;  bh->b = bh->f;  bh->c = bh->g;  bh->d = bh->h;
-
-                        is_overflow = 0;
-
-                        t1 = ret * bh->e;   detect_overflow(is_overflow);
-                        t2 = ret * bh->f;   detect_overflow(is_overflow);
-                        t3 = ret * bh->g;   detect_overflow(is_overflow);
-                        t4 = ret * bh->h;   detect_overflow(is_overflow);
-
-                        e = a - t1;
-                        f = b - t2;
-                        g = c - t3;
-                        h = d - t4;
-
-                        if (is_overflow)
-                        {
-                            bh->e = 0;
-                            bh->f = 0;
-                            bh->g = 0;
-                            bh->h = 0;
-                        }
-                        else
-                        {
-                            is_overflow = 0;
-
-                            t1 = a * p;       detect_overflow(is_overflow);
-                            t2 = b * p;       detect_overflow(is_overflow);
-                            t3 = e * p;       detect_overflow(is_overflow);
-                            t4 = f * p;       detect_overflow(is_overflow);
-
-                            A = t1 + c;       detect_overflow(is_overflow);
-                            B = t2 + d;       detect_overflow(is_overflow);
-                            C = a;
-                            D = b;
-
-                            E = t3 + g;       detect_overflow(is_overflow);
-                            F = t4 + h;       detect_overflow(is_overflow);
-                            G = e;
-                            H = f;
-
-                            if (is_overflow)
-                            {
-                                bh->e = 0;
-                                bh->f = 0;
-                                bh->g = 0;
-                                bh->h = 0;
-                            }
-                            else
-                            {
-                                bh->a = A;
-                                bh->b = B;
-                                bh->c = C;
-                                bh->d = D;
-
-                                bh->e = E;
-                                bh->f = F;
-                                bh->g = G;
-                                bh->h = H;
-                            }
-                        }
-                    }
-                    return ret;
-                } /* overflow exception handled }}} */
-                else
-                {
-                    bh->a = A;
-                    bh->b = B;
-                    bh->c = C;
-                    bh->d = D;
-
-                    bh->e = E;
-                    bh->f = F;
-                    bh->g = G;
-                    bh->h = H;
-                }
+                return ret;
             }
         }
         else
         {
-            long long p;
+            long long p, ret;
 
-            p = cf_next_term(bh->y);
-            if (p == LLONG_MAX && cf_is_finished(bh->y))
+            p = cf_term_block_next(&bh->yb, bh->y);
+            if (p == LLONG_MAX && cf_term_block_is_finished(&bh->yb, bh->y))
             {
-                bh->b = bh->a;
-                bh->d = bh->c;
-                bh->f = bh->e;
-                bh->h = bh->g;
+                coefs_set(&bh->k, BB, BA);
+                coefs_set(&bh->k, BD, BC);
+                coefs_set(&bh->k, BF, BE);
+                coefs_set(&bh->k, BH, BG);
             }
-            else
+            else if (bihomographic_ingest(bh, _bihomo_ingest_y, p, &ret))
             {
-                long long a = bh->a, b, c = bh->c, d, e = bh->e, f, g = bh->g, h;
-                long long A, B, C, D, E, F, G, H;
-                long long t1, t2, t3, t4;
-                int is_overflow = 0;
-
-                t1 = a * p;        detect_overflow(is_overflow);
-                t2 = c * p;        detect_overflow(is_overflow);
-                t3 = e * p;        detect_overflow(is_overflow);
-                t4 = g * p;        detect_overflow(is_overflow);
-
-                A = t1 + bh->b;    detect_overflow(is_overflow);
-                B = a;
-                C = t2 + bh->d;    detect_overflow(is_overflow);
-                D = c;
-
-                E = t3 + bh->f;    detect_overflow(is_overflow);
-                F = e;
-                G = t4 + bh->h;    detect_overflow(is_overflow);
-                H = g;
-
-                if (is_overflow)  /* {{{ handle overflow exception */
-                {
-                    long long ret = max( bh->e ? bh->a / bh->e : LLONG_MAX ,
-                                         max ( bh->f ? bh->b / bh->f : LLONG_MAX,
-                                               bh->g ? bh->c / bh->g : LLONG_MAX ) );
-                    // pre-output
-                    {
-                            a = bh->a;      b = bh->b;      c = bh->c;      d = bh->d;
-                        bh->a = bh->e;  bh->b = bh->f;  bh->c = bh->g;  bh->d = bh->h;
-
-                        is_overflow = 0;
-
-                        t1 = ret * bh->e;      detect_overflow(is_overflow);
-                        t2 = ret * bh->f;      detect_overflow(is_overflow);
-                        t3 = ret * bh->g;      detect_overflow(is_overflow);
-                        t4 = ret * bh->h;      detect_overflow(is_overflow);
-
-                        e = a - t1;
-                        f = b - t2;
-                        g = c - t3;
-                        h = d - t4;
-
-                        if (is_overflow)
-                        {
-                            bh->e = 0;
-                            bh->f = 0;
-                            bh->g = 0;
-                            bh->h = 0;
-                        }
-                        else
-                        {
-                            is_overflow = 0;
-
-                            t1 = a * p;      detect_overflow(is_overflow);
-                            t2 = c * p;      detect_overflow(is_overflow);
-                            t3 = e * p;      detect_overflow(is_overflow);
-                            t4 = g * p;      detect_overflow(is_overflow);
-
-                            A = t1 + b;      detect_overflow(is_overflow);
-                            B = a;
-                            C = t2 + d;      detect_overflow(is_overflow);
-                            D = c;
-
-                            E = t3 + f;      detect_overflow(is_overflow);
-                            F = e;
-                            G = t4 + h;      detect_overflow(is_overflow);
-                            H = g;
-
-                            if (is_overflow)
-                            {
-                                bh->e = 0;
-                                bh->f = 0;
-                                bh->g = 0;
-                                bh->h = 0;
-                            }
-                            else
-                            {
-                                bh->a = A;
-                                bh->b = B;
-                                bh->c = C;
-                                bh->d = D;
-
-                                bh->e = E;
-                                bh->f = F;
-                                bh->g = G;
-                                bh->h = H;
-                            }
-                        }
-                    }
-                    return ret;
-                } /* overflow exception is handled }}} */
-                else
-                {
-                    bh->a = A;
-                    bh->b = B;
-                    bh->c = C;
-                    bh->d = D;
-
-                    bh->e = E;
-                    bh->f = F;
-                    bh->g = G;
-                    bh->h = H;
-                }
+                return ret;
             }
         }
     }
     return LLONG_MAX;
 }
 
+static size_t bihomographic_next_terms(cf *c, long long *buf, size_t n)
+{
+    size_t i;
+    bihomographic * h = (bihomographic*) c;
+
+    for (i = 0; i < n && !bihomographic_done(h); ++i)
+    {
+        buf[i] = bihomographic_next_term(c);
+    }
+    return i;
+}
+
 static int bihomographic_is_finished(const cf * c)
 {
     bihomographic * h = (bihomographic*) c;
-    return h->e == 0ll && h->f == 0ll && h->g == 0ll && h->h == 0ll;
+    return bihomographic_done(h);
 }
 
 static void bihomographic_free(cf *c)
@@ -403,40 +238,68 @@ static void bihomographic_free(cf *c)
     bihomographic * h = (bihomographic*) c;
     cf_free(h->x);
     cf_free(h->y);
+    coefs_clear(&h->k);
     free(h);
 }
 
 static cf * bihomographic_copy(const cf * c)
 {
     bihomographic * h = (bihomographic*) c;
-    return cf_create_from_bihomographic(h->x, h->y,
-                                        h->a, h->b, h->c, h->d,
-                                        h->e, h->f, h->g, h->h);
+    bihomographic * copy;
+
+    cf_tape_share(&h->x);
+    cf_tape_share(&h->y);
+    copy = (bihomographic*) cf_create_from_bihomographic_bits(h->x, h->y,
+                                                              0, 0, 0, 0,
+                                                              0, 0, 0, 0,
+                                                              h->k.max_bits);
+    if (!copy)
+        return NULL;
+    coefs_init_copy(&copy->k, &h->k);
+    copy->xb = h->xb;
+    copy->yb = h->yb;
+    return &copy->base;
 }
 
 static cf_class _bihomographic_class = {
     bihomographic_next_term,
     bihomographic_is_finished,
     bihomographic_free,
-    bihomographic_copy
+    bihomographic_copy,
+    bihomographic_next_terms
 };
 
-cf * cf_create_from_bihomographic(const cf * x, const cf * y,
-                                  long long a, long long b, long long c, long long d,
-                                  long long e, long long f, long long g, long long h)
+cf * cf_create_from_bihomographic_bits(const cf * x, const cf * y,
+                                       long long a, long long b,
+                                       long long c, long long d,
+                                       long long e, long long f,
+                                       long long g, long long h,
+                                       unsigned max_bits)
 {
     bihomographic * bh = (bihomographic*)malloc(sizeof(bihomographic));
+    long long v[8];
 
     if (!bh)
         return NULL;
 
     bh->base.object_class = &_bihomographic_class;
 
-    bh->a = a; bh->b = b; bh->c = c; bh->d = d;
-    bh->e = e; bh->f = f; bh->g = g; bh->h = h;
+    v[BA] = a; v[BB] = b; v[BC] = c; v[BD] = d;
+    v[BE] = e; v[BF] = f; v[BG] = g; v[BH] = h;
+    coefs_init(&bh->k, 8, v, max_bits);
     bh->x = cf_copy(x);
     bh->y = cf_copy(y);
+    cf_term_block_init(&bh->xb);
+    cf_term_block_init(&bh->yb);
     return &bh->base;
 }
 
+cf * cf_create_from_bihomographic(const cf * x, const cf * y,
+                                  long long a, long long b, long long c, long long d,
+                                  long long e, long long f, long long g, long long h)
+{
+    return cf_create_from_bihomographic_bits(x, y, a, b, c, d, e, f, g, h,
+                                             BIHOMO_DEFAULT_BITS);
+}
+
 /* vim:set fdm=marker: */
@@ -15,33 +15,81 @@
 
 static cf_class _bihomo_mpz_class;
 
+/*
+ * Temporaries of bihomo_mpz_next_term(), kept in the instance so that
+ * emitting a term does not init and clear dozens of mpz on every call.
+ * The limbs are reserved once for the precision of the instance, and
+ * grow inside GMP only when a value really needs more.
+ */
+typedef struct _bihomo_mpz_scratch bihomo_mpz_scratch;
+struct _bihomo_mpz_scratch {
+    integer_t a, b, c, d, e, f, g, h;
+    integer_t ixy, ix, iy, i0;
+    integer_t dxyy, dxyx, d0y, d0x;
+    integer_t A, B, C, D, E, F, G, H;
+    integer_t t1, t2, t3, t4;
+    integer_t term;
+    integer_t ret, divae, divbf, divcg;
+};
+
 typedef struct _bihomo_mpz bihomo_mpz;
 struct _bihomo_mpz {
     cf base;
     integer_t a, b, c, d, e, f, g, h;
     cf *x, *y;
+    cf_term_block xb, yb;
+    bihomo_mpz_scratch s;
 };
 
+static void bihomo_mpz_scratch_init(bihomo_mpz_scratch *s, uint32_t precision)
+{
+    integer_ptr all[] = {
+        s->a, s->b, s->c, s->d, s->e, s->f, s->g, s->h,
+        s->ixy, s->ix, s->iy, s->i0,
+        s->dxyy, s->dxyx, s->d0y, s->d0x,
+        s->A, s->B, s->C, s->D, s->E, s->F, s->G, s->H,
+        s->t1, s->t2, s->t3, s->t4,
+        s->term,
+        s->ret, s->divae, s->divbf, s->divcg
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(all) / sizeof(all[0]); ++i)
+    {
+        integer_init2(all[i], precision);
+        /* products of two coefficients are twice as wide */
+        mpz_realloc2(all[i]->value, 2 * precision + 64);
+    }
+}
+
+static void bihomo_mpz_scratch_clear(bihomo_mpz_scratch *s)
+{
+    integer_clears(s->a, s->b, s->c, s->d, s->e, s->f, s->g, s->h,
+                   s->ixy, s->ix, s->iy, s->i0,
+                   s->dxyy, s->dxyx, s->d0y, s->d0x,
+                   s->A, s->B, s->C, s->D, s->E, s->F, s->G, s->H,
+                   s->t1, s->t2, s->t3, s->t4,
+                   s->term,
+                   s->ret, s->divae, s->divbf, s->divcg, NULL);
+}
+
 static long long bihomo_mpz_next_term(cf *_c)
 {
-    integer_t a, b, c, d, e, f, g, h;
-    integer_t ixy, ix, iy, i0;
-    integer_t dxyy, dxyx, d0y, d0x;
-    integer_t A, B, C, D, E, F, G, H;
-    integer_t t1, t2, t3, t4;
-    integer_t term;
+    bihomo_mpz * bh = (bihomo_mpz*) _c;
+    bihomo_mpz_scratch * s = &bh->s;
+
+    integer_ptr a = s->a, b = s->b, c = s->c, d = s->d;
+    integer_ptr e = s->e, f = s->f, g = s->g, h = s->h;
+    integer_ptr ixy = s->ixy, ix = s->ix, iy = s->iy, i0 = s->i0;
+    integer_ptr dxyy = s->dxyy, dxyx = s->dxyx, d0y = s->d0y, d0x = s->d0x;
+    integer_ptr A = s->A, B = s->B, C = s->C, D = s->D;
+    integer_ptr E = s->E, F = s->F, G = s->G, H = s->H;
+    integer_ptr t1 = s->t1, t2 = s->t2, t3 = s->t3, t4 = s->t4;
+    integer_ptr term = s->term;
     integer_ptr p1, p2;
     unsigned limit = 10000;
     long long result = LLONG_MAX;
 
-    bihomo_mpz * bh = (bihomo_mpz*) _c;
-
-    integer_inits_pre(bh->a->precision, a, b, c, d, e, f, g, h, NULL);
-    integer_inits_pre(bh->a->precision, ixy, ix, iy, i0, NULL);
-    integer_inits_pre(bh->a->precision, dxyy, dxyx, d0y, d0x, NULL);
-    integer_inits_pre(bh->a->precision, A, B, C, D, E, F, G, H, NULL);
-    integer_inits_pre(bh->a->precision, t1, t2, t3, t4, term, NULL);
-
     while (--limit)
     {
         int input_x;
@@ -159,8 +207,8 @@ static long long bihomo_mpz_next_term(cf *_c)
         {
             long long p;
 
-            p = cf_next_term(bh->x);
-            if (p == LLONG_MAX && cf_is_finished(bh->x))
+            p = cf_term_block_next(&bh->xb, bh->x);
+            if (p == LLONG_MAX && cf_term_block_is_finished(&bh->xb, bh->x))
             {
                 integer_set(bh->c, bh->a);
                 integer_set(bh->d, bh->b);
@@ -195,11 +243,9 @@ static long long bihomo_mpz_next_term(cf *_c)
 
                 if (is_overflow) /* {{{ handle overflow exception */
                 {
-                    integer_t ret;
-                    integer_t divae, divbf, divcg;
+                    integer_ptr ret = s->ret;
+                    integer_ptr divae = s->divae, divbf = s->divbf, divcg = s->divcg;
 
-                    integer_init2(ret, bh->a->precision);
-                    integer_inits_pre(bh->a->precision, divae, divbf, divcg, NULL);
                     if (integer_is_zero(bh->e) || integer_is_zero(bh->f) || integer_is_zero(bh->g))
                     {
                         result = LLONG_MAX;
@@ -287,8 +333,6 @@ static long long bihomo_mpz_next_term(cf *_c)
                             }
                         }
                     }
-                    integer_clear(ret);
-                    integer_clears(divae, divbf, divcg, NULL);
                     goto exit_func;
                 } /* overflow exception handled }}} */
                 else
@@ -308,8 +352,8 @@ static long long bihomo_mpz_next_term(cf *_c)
         {
             long long p;
 
-            p = cf_next_term(bh->y);
-            if (p == LLONG_MAX && cf_is_finished(bh->y))
+            p = cf_term_block_next(&bh->yb, bh->y);
+            if (p == LLONG_MAX && cf_term_block_is_finished(&bh->yb, bh->y))
             {
                 integer_set(bh->b, bh->a);
                 integer_set(bh->d, bh->c);
@@ -344,11 +388,9 @@ static long long bihomo_mpz_next_term(cf *_c)
 
                 if (is_overflow)  /* {{{ handle overflow exception */
                 {
-                    integer_t ret;
-                    integer_t divae, divbf, divcg;
+                    integer_ptr ret = s->ret;
+                    integer_ptr divae = s->divae, divbf = s->divbf, divcg = s->divcg;
 
-                    integer_init2(ret, bh->a->precision);
-                    integer_inits_pre(bh->a->precision, divae, divbf, divcg, NULL);
                     if (integer_is_zero(bh->e) || integer_is_zero(bh->f) || integer_is_zero(bh->g))
                     {
                         result = LLONG_MAX;
@@ -436,8 +478,6 @@ static long long bihomo_mpz_next_term(cf *_c)
                             }
                         }
                     }
-                    integer_clear(ret);
-                    integer_clears(divae, divbf, divcg, NULL);
                     goto exit_func;
                 } /* overflow exception is handled }}} */
                 else
@@ -455,15 +495,23 @@ static long long bihomo_mpz_next_term(cf *_c)
         }
     }
 exit_func:
-    integer_clears(a, b, c, d, e, f, g, h, NULL);
-    integer_clears(ixy, ix, iy, i0, NULL);
-    integer_clears(dxyy, dxyx, d0y, d0x, NULL);
-    integer_clears(A, B, C, D, E, F, G, H, NULL);
-    integer_clears(t1, t2, t3, t4, term, NULL);
-
     return result;
 }
 
+static size_t bihomo_mpz_next_terms(cf *c, long long *buf, size_t n)
+{
+    size_t i;
+    bihomo_mpz * h = (bihomo_mpz*) c;
+
+    for (i = 0; i < n &&
+         !(integer_is_zero(h->e) && integer_is_zero(h->f) &&
+           integer_is_zero(h->g) && integer_is_zero(h->h)); ++i)
+    {
+        buf[i] = bihomo_mpz_next_term(c);
+    }
+    return i;
+}
+
 static int bihomo_mpz_is_finished(const cf * c)
 {
     bihomo_mpz * h = (bihomo_mpz*) c;
@@ -475,6 +523,7 @@ static void bihomo_mpz_free(cf *c)
 {
     bihomo_mpz * h = (bihomo_mpz*) c;
     integer_clears(h->a, h->b, h->c, h->d, h->e, h->f, h->g, h->h, NULL);
+    bihomo_mpz_scratch_clear(&h->s);
     cf_free(h->x);
     cf_free(h->y);
     free(h);
@@ -501,8 +550,13 @@ static cf * bihomo_mpz_copy(const cf * c)
     integer_set(bh->f, h->f);
     integer_set(bh->g, h->g);
     integer_set(bh->h, h->h);
+    bihomo_mpz_scratch_init(&bh->s, h->a->precision);
+    cf_tape_share(&h->x);
+    cf_tape_share(&h->y);
     bh->x = cf_copy(h->x);
     bh->y = cf_copy(h->y);
+    bh->xb = h->xb;
+    bh->yb = h->yb;
     return &bh->base;
 }
 
@@ -510,7 +564,8 @@ static cf_class _bihomo_mpz_class = {
     bihomo_mpz_next_term,
     bihomo_mpz_is_finished,
     bihomo_mpz_free,
-    bihomo_mpz_copy
+    bihomo_mpz_copy,
+    bihomo_mpz_next_terms
 };
 
 cf * cf_create_from_bihomo_pre(const cf * x, const cf * y,
@@ -533,8 +588,11 @@ cf * cf_create_from_bihomo_pre(const cf * x, const cf * y,
     integer_init2_with_int64(bh->f, f, precision);
     integer_init2_with_int64(bh->g, g, precision);
     integer_init2_with_int64(bh->h, h, precision);
+    bihomo_mpz_scratch_init(&bh->s, precision);
     bh->x = cf_copy(x);
     bh->y = cf_copy(y);
+    cf_term_block_init(&bh->xb);
+    cf_term_block_init(&bh->yb);
     return &bh->base;
 }
 
@@ -0,0 +1,381 @@
+/**
+ * decimal strings of continued fractions in bulk.
+ *
+ * \date 2026-10-17
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cf.h"
+#include "common.h"
+
+/* terms retrieved beyond the digits at first */
+#define BULK_EXTRA_TERMS 64
+
+/* the terms are retrieved in BULK_CHUNKS chunks, of BULK_CHUNK_TERMS at least */
+#define BULK_CHUNKS 16
+#define BULK_CHUNK_TERMS 4096
+
+/* levels of the products of chunks, one for each bit of a count */
+#define BULK_LEVELS 64
+
+/* digits converted by mpz_get_str() at once when written */
+#define BULK_LEAF_DIGITS 16384
+
+/*
+ * Decimal digits of a value, truncated toward zero.
+ */
+typedef struct _bulk_value bulk_value;
+struct _bulk_value {
+    int sgn;
+    mpz_t ip;       /* the integer part, in `ilen' digits */
+    mpz_t f;        /* the fractional part in `frac' digits */
+    size_t ilen;
+    long frac;      /* <= 0 for none */
+    int is_int;     /* the value is the integer ip */
+    int ends;       /* the value is ip.f */
+};
+
+/*
+ * Work out the digits of n / d like cf_convert_to_string_float().
+ *
+ * If `exact' is 0 the value is only known to be between n / d and
+ * n2 / d2, and the digits are those shared by both ends.  Returns 0, or
+ * -1 if they do not share all the digits asked for.
+ */
+static int bulk_digits(bulk_value *v, mpz_t n, mpz_t d, mpz_t n2, mpz_t d2,
+                       int exact, int max_digits)
+{
+    mpz_t rem, ip2, rem2, f2;
+    int result = -1;
+
+    mpz_inits(rem, ip2, rem2, f2, NULL);
+    v->sgn = mpz_sgn(n) * mpz_sgn(d);
+    if (!exact && v->sgn != mpz_sgn(n2) * mpz_sgn(d2))
+        goto EXIT_FUNC;
+
+    /* the integer part */
+    mpz_tdiv_qr(v->ip, rem, n, d);
+    mpz_abs(v->ip, v->ip);
+    mpz_abs(rem, rem);
+    if (!exact)
+    {
+        mpz_tdiv_qr(ip2, rem2, n2, d2);
+        mpz_abs(ip2, ip2);
+        mpz_abs(rem2, rem2);
+        if (mpz_cmp(v->ip, ip2) != 0)
+            goto EXIT_FUNC;
+    }
+    v->is_int = exact && mpz_sgn(rem) == 0;
+
+    /* the digits of the integer part but one take from max_digits */
+    v->ilen = mpz_sizeinbase(v->ip, 10);
+    if (v->ilen > 1)
+    {
+        mpz_ui_pow_ui(f2, 10u, v->ilen - 1);
+        if (mpz_cmp(v->ip, f2) < 0)
+            --v->ilen;
+    }
+    v->frac = (long)max_digits - (long)v->ilen + 1;
+    v->ends = 0;
+    if (v->frac > 0)
+    {
+        mpz_ui_pow_ui(f2, 10u, (unsigned long)v->frac);
+        mpz_mul(v->f, rem, f2);
+        mpz_abs(d, d);
+        mpz_tdiv_qr(v->f, rem, v->f, d);
+        if (!exact)
+        {
+            mpz_mul(rem2, rem2, f2);
+            mpz_abs(d2, d2);
+            mpz_tdiv_q(f2, rem2, d2);
+            if (mpz_cmp(v->f, f2) != 0)
+                goto EXIT_FUNC;
+        }
+        v->ends = exact && mpz_sgn(rem) == 0;
+    }
+    result = 0;
+
+EXIT_FUNC:
+    mpz_clears(rem, ip2, rem2, f2, NULL);
+    return result;
+}
+
+/*
+ * Work out the digits of c in bulk.  Returns 0, or -1 if c has to be
+ * converted by the digit generator.
+ *
+ * About as many terms as digits are needed (a term gives 0.97 digits on
+ * average, by the theorem of Levy).  They are retrieved in chunks of a
+ * sixteenth of them, so that the buffer of terms is small beside the
+ * numbers, and the products of the chunks are merged in the way of a
+ * binary counter: two products of a level make one of the next, which
+ * keeps them balanced as in a single product tree.  A CF like pi is
+ * asked for all the terms at first, so that it works them out at once at
+ * the precision needed.
+ */
+static int bulk_evaluate(bulk_value *v, const cf *c, int max_digits)
+{
+    size_t want = (size_t)max_digits + BULK_EXTRA_TERMS;
+    size_t cap, n, i, bits, count = 0;
+    long long * terms;
+    mpz_t s[BULK_LEVELS][4], m[4], t, n2, d2;
+    mpz_t * p;
+    int level[BULK_LEVELS], top = 0, used = 0, result = -1, j;
+    cf * x;
+
+    cap = want / BULK_CHUNKS;
+    if (cap < BULK_CHUNK_TERMS)
+        cap = BULK_CHUNK_TERMS;
+    terms = (long long*)malloc(cap * sizeof(long long));
+    x = cf_copy(c);
+    if (!terms || !x)
+    {
+        free(terms);
+        if (x)
+            cf_free(x);
+        return -1;
+    }
+    cf_reserve_terms(x, want);
+
+    mpz_inits(m[0], m[1], m[2], m[3], t, n2, d2, NULL);
+    for (;;)
+    {
+        int exact;
+
+        n = cf_next_terms(x, terms, cap);
+        for (i = 0; i < n; ++i)
+        {
+            /* the bounds below are for canonical terms only */
+            if ((count + i > 0 && terms[i] < 1) || terms[i] == LLONG_MAX)
+                goto EXIT_FUNC;
+        }
+        count += n;
+        if (n > 0)
+        {
+            /* at most one product of a level, so there are few levels */
+            if (top == used)
+            {
+                mpz_inits(s[used][0], s[used][1], s[used][2], s[used][3], NULL);
+                ++used;
+            }
+            cf_matrix_product(terms, n, s[top], t);
+            level[top++] = 0;
+            while (top >= 2 && level[top - 1] == level[top - 2])
+            {
+                cf_matrix_mul(s[top - 2], s[top - 1], t);
+                ++level[top - 2];
+                --top;
+            }
+        }
+
+        /* the ends below are about 1 / m2^2 apart: no digits before */
+        exact = cf_is_finished(x);
+        for (bits = 0, j = 0; j < top; ++j)
+        {
+            bits += mpz_sizeinbase(s[j][2], 2);
+        }
+        if (!exact && (double)bits * 0.60206 < (double)max_digits + 2)
+            continue;
+
+        /* m = s[0] s[1] ... s[top-1], the product of all the terms */
+        if (top == 1)
+        {
+            p = s[0];
+        }
+        else
+        {
+            mpz_set_ui(m[0], 1u);
+            mpz_set_ui(m[1], 0u);
+            mpz_set_ui(m[2], 0u);
+            mpz_set_ui(m[3], 1u);
+            for (j = 0; j < top; ++j)
+            {
+                cf_matrix_mul(m, s[j], t);
+            }
+            p = m;
+        }
+
+        /*
+         * x = (p0 y + p1) / (p2 y + p3) for the rest y >= 1, which is
+         * between p0 / p2 (y infinite) and (p0 + p1) / (p2 + p3) (y = 1).
+         */
+        if (mpz_sgn(p[2]) == 0)
+        {
+            if (exact)
+                break;
+            continue;
+        }
+        /* p2 and p3 are denominators, which are not negative */
+        mpz_add(n2, p[0], p[1]);
+        mpz_add(d2, p[2], p[3]);
+        if (bulk_digits(v, p[0], p[2], n2, d2, exact, max_digits) == 0)
+        {
+            result = 0;
+            break;
+        }
+        if (exact)
+            break;
+    }
+
+EXIT_FUNC:
+    for (j = 0; j < used; ++j)
+    {
+        mpz_clears(s[j][0], s[j][1], s[j][2], s[j][3], NULL);
+    }
+    mpz_clears(m[0], m[1], m[2], m[3], t, n2, d2, NULL);
+    free(terms);
+    cf_free(x);
+    return result;
+}
+
+/*
+ * Writing of long numbers: they are split by powers of ten into halves,
+ * written one after the other, so that the digits go out in order and
+ * only the numbers of BULK_LEAF_DIGITS are ever converted to strings.
+ * The halves of a level are of two widths at most, and their powers are
+ * kept for all of them.
+ */
+#define BULK_POWERS 128
+
+typedef struct _bulk_out bulk_out;
+struct _bulk_out {
+    cf_writer * w;
+    char * buf;         /* BULK_LEAF_DIGITS + 2 */
+    int npow;
+    size_t exp[BULK_POWERS];
+    mpz_t pow[BULK_POWERS];
+};
+
+static mpz_srcptr bulk_power(bulk_out *out, size_t e, mpz_t tmp)
+{
+    int i;
+
+    for (i = 0; i < out->npow; ++i)
+    {
+        if (out->exp[i] == e)
+            return out->pow[i];
+    }
+    if (out->npow == BULK_POWERS)
+    {
+        mpz_ui_pow_ui(tmp, 10u, e);
+        return tmp;
+    }
+    i = out->npow++;
+    out->exp[i] = e;
+    mpz_init(out->pow[i]);
+    mpz_ui_pow_ui(out->pow[i], 10u, e);
+    return out->pow[i];
+}
+
+/*
+ * Write v < 10^width in `width' digits, padded with zeros.
+ */
+static void bulk_write_digits(bulk_out *out, mpz_t v, size_t width)
+{
+    cf_writer * w = out->w;
+
+    if (w->error)
+        return;
+    if (width <= BULK_LEAF_DIGITS)
+    {
+        size_t len;
+
+        mpz_get_str(out->buf, 10, v);
+        len = strlen(out->buf);
+        for (; width > len + 16; width -= 16)
+            cf_writer_put(w, "0000000000000000", 16);
+        cf_writer_put(w, "0000000000000000", width - len);
+        cf_writer_put(w, out->buf, len);
+    }
+    else
+    {
+        size_t low = width / 2;
+        mpz_t hi, lo;
+
+        mpz_inits(hi, lo, NULL);
+        mpz_tdiv_qr(hi, lo, v, bulk_power(out, low, lo));
+        bulk_write_digits(out, hi, width - low);
+        mpz_clear(hi);
+        bulk_write_digits(out, lo, low);
+        mpz_clear(lo);
+    }
+}
+
+static void bulk_write(cf_writer *w, bulk_value *v)
+{
+    bulk_out out;
+
+    out.w = w;
+    out.npow = 0;
+    out.buf = (char*)malloc(BULK_LEAF_DIGITS + 2);
+    if (!out.buf)
+    {
+        w->error = 1;
+        return;
+    }
+
+    if (v->sgn < 0)
+        cf_writer_puts(w, "-");
+    bulk_write_digits(&out, v->ip, v->ilen);
+    if (!v->is_int)
+    {
+        cf_writer_puts(w, ".");
+        if (v->ends && mpz_sgn(v->f) != 0)
+        {
+            /* the value ends inside the digits, without the zeros */
+            mpz_t ten;
+            mpz_init_set_ui(ten, 10u);
+            v->frac -= (long)mpz_remove(v->f, v->f, ten);
+            mpz_clear(ten);
+        }
+        if (v->frac > 0)
+            bulk_write_digits(&out, v->f, (size_t)v->frac);
+        if (!v->ends)
+            cf_writer_puts(w, "...");
+    }
+
+    while (out.npow > 0)
+    {
+        mpz_clear(out.pow[--out.npow]);
+    }
+    free(out.buf);
+}
+
+int cf_write_float_to(cf_sink sink, void *data, const cf *c, int max_digits)
+{
+    cf_writer w;
+    bulk_value v;
+
+    cf_writer_init(&w, sink, data);
+    mpz_inits(v.ip, v.f, NULL);
+    if (max_digits <= 0)
+    {
+        cf_writer_puts(&w, "NAN");
+    }
+    else if (bulk_evaluate(&v, c, max_digits) != 0)
+    {
+        /* not canonical, or not ending in the integers */
+        cf_digit_gen_write_float(&w, c, max_digits);
+    }
+    else
+    {
+        bulk_write(&w, &v);
+    }
+    mpz_clears(v.ip, v.f, NULL);
+    return cf_writer_flush(&w);
+}
+
+char * cf_convert_to_string_float_bulk(const cf *c, int max_digits)
+{
+    cf_string str = {NULL, 0, 0};
+
+    if (cf_write_float_to(cf_string_sink, &str, c, max_digits) != 0)
+    {
+        free(str.s);
+        return NULL;
+    }
+    return str.s;
+}
@@ -4,6 +4,8 @@
 #include <limits.h>
 
 #include "cf.h"
+#include "common.h"
+#include "cf_mpz.h"
 
 /*!
  * continued fration
@@ -46,6 +48,18 @@ static long long rational_next_term(struct _cf *c)
     return v;
 }
 
+static size_t rational_next_terms(cf *c, long long *buf, size_t n)
+{
+    size_t i;
+    rational * r = (rational*) c;
+
+    for (i = 0; i < n && r->current.d != 0ll; ++i)
+    {
+        buf[i] = rational_next_term(c);
+    }
+    return i;
+}
+
 static int rational_is_finished(const cf * c)
 {
     rational * r = (rational*) c;
@@ -68,7 +82,8 @@ static cf_class _rational_class = {
     rational_next_term,
     rational_is_finished,
     rational_free,
-    rational_copy
+    rational_copy,
+    rational_next_terms
 };
 
 cf * cf_create_from_fraction(fraction f)
@@ -99,18 +114,28 @@ cf * cf_create_from_fraction(fraction f)
     return &r->base;
 }
 
-long long cf_get_gcd(long long a, long long b)
+size_t cf_next_terms(cf *c, long long *buf, size_t n)
 {
-    long long gcd;
-    cf * c = cf_create_from_fraction((fraction){a, b});
-    rational * r = (rational*) c;
-    while (!cf_is_finished(c))
+    size_t i;
+
+    if (cf_class(c)->next_terms)
+    {
+        return cf_class(c)->next_terms(c, buf, n);
+    }
+
+    for (i = 0; i < n && !cf_is_finished(c); ++i)
+    {
+        buf[i] = cf_next_term(c);
+    }
+    return i;
+}
+
+void cf_reserve_terms(cf *c, size_t n)
+{
+    if (cf_class(c)->reserve)
     {
-        cf_next_term(c);
+        cf_class(c)->reserve(c, n);
     }
-    gcd = r->current.n;
-    cf_free(c);
-    return gcd;
 }
 
 int cf_compare(const cf *_x, const cf *_y)
@@ -296,75 +321,250 @@ fraction rational_best_in(const cf* cf1, const cf* cf2)
 #undef ENLARGE_BUFFER
 }
 
+/*
+ * Terms of |x| for the best rationals: a negative x is read as -x,
+ *
+ *     -[a0; a1, a2, ...] = [-a0 - 1; 1, a1 - 1, a2, ...]
+ *                        = [-a0 - 1; a2 + 1, a3, ...]     if a1 = 1,
+ *                        = [-a0 - 1; 2]                   if x = [a0; 2],
+ *
+ * with the first terms in `head', so that the terms of -x are canonical
+ * as those of x, and a tie is decided for -x as for x.  LLONG_MAX ends
+ * the terms, and a term below 1 after a0, which is not canonical, ends
+ * them with `bad' set.
+ */
+typedef struct _best_terms best_terms;
+struct _best_terms {
+    cf * x;
+    long long head[4];
+    int pos, len;
+    int read;           /* terms read from x */
+    int bad;
+};
 
-char * cf_convert_to_string_canonical(const cf *c, int max_terms)
+static long long best_next(best_terms *b)
 {
-    cf * x = cf_copy(c);
-    char buf[64], *p, *result;
-    int size, count;
-    int realloced = 0;
+    long long t;
 
-    p = buf;
-    size = sizeof(buf);
-    count = 0;
-    realloced = 0;
+    if (b->pos < b->len)
+        return b->head[b->pos++];
+    if (b->bad || cf_is_finished(b->x))
+        return LLONG_MAX;
+    t = cf_next_term(b->x);
+    if (b->read++ > 0 && t < 1)
+    {
+        b->bad = 1;
+        return LLONG_MAX;
+    }
+    return t;
+}
 
-    while (max_terms > 0 && !cf_is_finished(x))
+static int best_init(best_terms *b, cf *x)
+{
+    long long a0, a1, a2;
+
+    b->x = x;
+    b->pos = b->len = 0;
+    b->read = b->bad = 0;
+    a0 = best_next(b);
+    if (a0 == LLONG_MAX || a0 >= 0)
     {
-        long long coef = cf_next_term(x);
-        int chars = snprintf(p + count, size - count,
-                             count ? " %lld" : "[%lld", coef);
-        if (!cf_is_finished(x))
-        {
-            snprintf(p + count + chars, size - count - chars,
-                     count ? "," : ";");
-            ++count;
-        }
-        count += chars;
-        --max_terms;
-        // reallocate new buffer to contain the too long string.
-        if (count > size - 7)
-        {
-            int new_size = size << 1;
-            char * new_buf = (char*)malloc(new_size);
-            if (!new_buf)
-            {
-                // failed.
-                break;
-            }
-            memcpy(new_buf, p, count);
-            if (realloced)
-            {
-                free(p);
-            }
-            p = new_buf;
-            size = new_size;
-            realloced = 1;
-        }
+        b->head[b->len++] = a0;
+        return 0;
     }
+    a1 = best_next(b);
+    if (a1 == LLONG_MAX)
+    {
+        b->head[b->len++] = -a0;
+        return 1;
+    }
+    a2 = best_next(b);
+    b->head[b->len++] = -a0 - 1;
+    if (a1 == 1)
+    {
+        if (a2 != LLONG_MAX)
+            b->head[b->len++] = a2 + 1;
+    }
+    else if (a1 == 2 && a2 == LLONG_MAX)
+    {
+        b->head[b->len++] = 2;
+    }
+    else
+    {
+        b->head[b->len++] = 1;
+        b->head[b->len++] = a1 - 1;
+        if (a2 != LLONG_MAX)
+            b->head[b->len++] = a2;
+    }
+    return 1;
+}
 
-    if (count)
+/*
+ * Check whether the rest y of the terms is greater than u / v.
+ *
+ * y = a + 1 / y' and u / v = f + r / v are compared by their integer
+ * parts, and if a = f, y > u / v as y' < v / r, and so on in the way of
+ * the Euclidean algorithm.
+ */
+static int best_tail_greater(best_terms *b, unsigned long long u,
+                             unsigned long long v)
+{
+    int greater = 1;    /* checking y > u / v, or y < u / v */
+
+    for (;;)
+    {
+        long long a = best_next(b);
+        unsigned long long f, r;
+
+        if (a == LLONG_MAX)
+            return v ? greater : 0;     /* y is infinite */
+        if (v == 0)
+            return !greater;
+        f = u / v;
+        r = u % v;
+        if ((unsigned long long)a != f)
+            return ((unsigned long long)a > f) == greater;
+        u = v;
+        v = r;
+        greater = !greater;
+    }
+}
+
+/*
+ * The best of the terms of b, or -1 if they are not canonical.
+ */
+static int best_bound(best_terms *b, int neg, unsigned long long maxden,
+                      unsigned long long maxnum, fraction *best)
+{
+    /* p_{k-1} / q_{k-1} and p_k / q_k, from p_{-2} / q_{-2} = 0 / 1 */
+    unsigned long long pm = 0, qm = 1, pk = 1, qk = 0;
+    unsigned long long jd, jn, j, a;
+    fraction r;
+
+    for (;;)
     {
-        if (!cf_is_finished(x))
+        long long t = best_next(b);
+
+        if (t == LLONG_MAX)
         {
-            strcpy(p+count, " ...]");
+            /* the value itself is in the bounds */
+            r = qk ? (fraction){pk, qk} : (fraction){pm, qm};
+            break;
         }
+
+        /*
+         * The fractions (j p_k + p_{k-1}) / (j q_k + q_{k-1}) for j up to
+         * a_{k+1} are the semiconvergents, with the convergent p_{k+1} /
+         * q_{k+1} at a_{k+1}.  The largest j in the bounds is worked out
+         * at once.
+         */
+        a = (unsigned long long)t;
+        jd = qk ? (maxden - qm) / qk : a;
+        if (pm > maxnum)
+            jn = 0;
         else
+            jn = pk ? (maxnum - pm) / pk : a;
+        j = jd < jn ? jd : jn;
+        if (j >= a)
         {
-            strcpy(p+count, "]");
+            unsigned long long p = a * pk + pm, q = a * qk + qm;
+            pm = pk;
+            qm = qk;
+            pk = p;
+            qk = q;
+            continue;
         }
+
+        /*
+         * The best is p_k / q_k or the semiconvergent of j, on both sides
+         * of x = (p_k y + p_{k-1}) / (q_k y + q_{k-1}), y = [a_{k+1}; ...].
+         * The semiconvergent is closer as y < 2 j + q_{k-1} / q_k, that is
+         * for 2 j > a_{k+1}, and for 2 j = a_{k+1} if [a_{k+2}; ...] is
+         * greater than q_k / q_{k-1}.  Below a0, j / 1 is the closest.
+         */
+        if (qk == 0 ||
+            (j > 0 && (2 * j > a ||
+                       (2 * j == a && best_tail_greater(b, qk, qm)))))
+            r = (fraction){j * pk + pm, j * qk + qm};
+        else
+            r = (fraction){pk, qk};
+        break;
     }
-    else
+
+    if (b->bad)
+        return -1;
+    if (neg)
+        r.n = -r.n;
+    *best = r;
+    return 0;
+}
+
+/*
+ * The canonical CF of the value of c, from its convergent at the end or
+ * after BEST_TERMS terms, which is closer to it than any two fractions
+ * of denominators in long long are to each other.
+ */
+#define BEST_TERMS 4096
+
+static cf * best_canonical(const cf *c)
+{
+    long long * terms = (long long*)malloc(BEST_TERMS * sizeof(long long));
+    cf * x = cf_copy(c);
+    cf * r = NULL;
+    size_t n, i;
+    mpz_t m[4], t;
+
+    if (terms && x)
     {
-        strcpy(p, "[NAN]");
+        n = cf_next_terms(x, terms, BEST_TERMS);
+        for (i = 0; i < n && terms[i] != LLONG_MAX; ++i)
+            ;
+        mpz_inits(m[0], m[1], m[2], m[3], t, NULL);
+        cf_matrix_product(terms, i, m, t);
+        if (mpz_sgn(m[2]) != 0)
+            r = cf_create_from_mpz_fraction(m[0], m[2]);
+        else
+            r = cf_create_from_fraction((fraction){1ll, 0ll});
+        mpz_clears(m[0], m[1], m[2], m[3], t, NULL);
     }
+    free(terms);
+    if (x)
+        cf_free(x);
+    return r;
+}
 
-    result = strdup(p);
-    if (realloced)
+fraction rational_best_with_bound(const cf *c, long long maxden,
+                                  long long maxnum)
+{
+    best_terms b;
+    fraction r = {0ll, 0ll};
+    int neg, result;
+    cf * x;
+
+    if (maxden < 1 || maxnum < 0 || !(x = cf_copy(c)))
+        return r;
+    neg = best_init(&b, x);
+    result = best_bound(&b, neg, maxden, maxnum, &r);
+    cf_free(x);
+
+    if (result != 0 && (x = best_canonical(c)) != NULL)
     {
-        free(p);
+        /* terms below 1 after a0: the value is expanded again */
+        neg = best_init(&b, x);
+        best_bound(&b, neg, maxden, maxnum, &r);
+        cf_free(x);
     }
-    cf_free(x);
+    return r;
+}
+
+char * cf_convert_to_string_canonical(const cf *c, int max_terms)
+{
+    cf_string str = {NULL, 0, 0};
 
-    return result;
+    if (cf_write_canonical_to(cf_string_sink, &str, c, max_terms) != 0)
+    {
+        free(str.s);
+        return NULL;
+    }
+    return str.s;
 }
@@ -78,7 +78,8 @@ static void help(char * name)
                     "    -v, --reverse           convert a continued fraction into fraction\n"
                     "\n"
                     "        --sqrt              square root\n"
-                    "        --int-bits=bits     integer precision in bits to calculate bihomographic\n"
+                    "        --int-bits=bits     limit of integer precision in bits to calculate\n"
+                    "                            bihomographic (default 1024)\n"
                     "        --root=m/n          root of {}^{m/n}\n"
                     "    -f  --float=precision   generate float expression\n"
                     "\n"
@@ -667,10 +668,8 @@ static int parse_options(int argc, char ** argv, struct context *ctx)
                 cfy = cf_create_from_string_float(ctx->den);
                 if (ctx->is_float)
                 {
-                    if (ctx->int_bits < 64)
-                        ctx->x = cf_create_from_bihomographic(cfx, cfy, 0, 1, 0, 0, 0, 0, 1, 0);
-                    else
-                        ctx->x = cf_create_from_bihomo_pre(cfx, cfy, 0, 1, 0, 0, 0, 0, 1, 0, ctx->int_bits);
+                    ctx->x = cf_create_from_bihomographic_bits(cfx, cfy, 0, 1, 0, 0, 0, 0, 1, 0,
+                                                               ctx->int_bits);
                     cf_free(cfx);
                     cf_free(cfy);
                 }
@@ -724,7 +723,7 @@ int main(int argc, char ** argv)
     ctx.limits.max_index = INT_MAX;
     ctx.is_welformed = 1;
     ctx.find_root = 0;
-    ctx.int_bits = 63;
+    ctx.int_bits = 1024;
     ctx.root_m = 1;
     ctx.root_n = 1;
     ctx.prints_float = -1;
@@ -765,14 +764,9 @@ int main(int argc, char ** argv)
                 cf * c1 = cf_create_from_fraction(f1);
                 cf * c2 = cf_create_from_fraction(f2);
                 cf * c;
-                if (ctx.int_bits < 64)
-                    c  = cf_create_from_bihomographic(c1, c2,
-                                                      0, 1, 0, 0,
-                                                      0, 0, 1, 0);
-                else
-                    c  = cf_create_from_bihomo_pre(c1, c2,
-                                                   0, 1, 0, 0,
-                                                   0, 0, 1, 0, ctx.int_bits);
+                c  = cf_create_from_bihomographic_bits(c1, c2,
+                                                       0, 1, 0, 0,
+                                                       0, 0, 1, 0, ctx.int_bits);
                 cf_free(ctx_simp.x);
                 ctx_simp.x = c;
                 cf_free(c1);
@@ -797,18 +791,22 @@ int main(int argc, char ** argv)
         {
             ctx.x = cfx;
         }
+        else if (ctx.find_root == 1 && f.d != 0ll &&
+                 (unsigned long long)f.n <= ULLONG_MAX / (unsigned long long)f.d)
+        {
+            /* sqrt(n / d) = sqrt(n d) / d */
+            ctx.x = cf_create_from_quadratic(0, (is_minus ? -1 : 1),
+                                             (unsigned long long)f.n * f.d, f.d);
+            cf_free(cfx);
+        }
         else
         {
             if (ctx.find_root == 1)
                 cfy = cf_create_from_sqrt_n(f.d);
             else
                 cfy = cf_create_from_nth_root(f.d, ctx.root_n, ctx.root_m);
-            if (ctx.int_bits < 64)
-                ctx.x = cf_create_from_bihomographic(cfx, cfy, 0, (is_minus? -1 : 1), 0, 0,
-                                                     0, 0, 1, 0);
-            else
-                ctx.x = cf_create_from_bihomo_pre(cfx, cfy, 0, (is_minus? -1 : 1), 0, 0,
-                                                  0, 0, 1, 0, ctx.int_bits);
+            ctx.x = cf_create_from_bihomographic_bits(cfx, cfy, 0, (is_minus? -1 : 1), 0, 0,
+                                                      0, 0, 1, 0, ctx.int_bits);
             cf_free(cfx);
             cf_free(cfy);
         }
@@ -863,23 +861,28 @@ int main(int argc, char ** argv)
                     cf * c1 = cf_create_from_fraction(f1);
                     cf * c2 = cf_create_from_fraction(f2);
                     cf * c;
-                    if (ctx.int_bits < 64)
-                        c  = cf_create_from_bihomographic(c1, c2,
-                                                          0, 1, 0, 0,
-                                                          0, 0, 1, 0);
-                    else
-                        c  = cf_create_from_bihomo_pre(c1, c2,
-                                                       0, 1, 0, 0,
-                                                       0, 0, 1, 0, ctx.int_bits);
+                    c  = cf_create_from_bihomographic_bits(c1, c2,
+                                                           0, 1, 0, 0,
+                                                           0, 0, 1, 0, ctx.int_bits);
                     cf_free(ctx.x);
                     ctx.x = c;
                     cf_free(c1);
                     cf_free(c2);
                 }
             }
-            ctx.steps = (struct cfstep*) calloc(1, sizeof(struct cfstep));
-            cfr(ctx.x, 0, &ctx.limits, cfrcb_accept_simp, &ctx);
-            f = ctx.steps->t.convergent;
+            if (ctx.limits.max_index == INT_MAX)
+            {
+                /* the best within the bounds, semiconvergents included */
+                f = rational_best_with_bound(ctx.x,
+                                             ctx.limits.max_denominator,
+                                             ctx.limits.max_numerator);
+            }
+            else
+            {
+                ctx.steps = (struct cfstep*) calloc(1, sizeof(struct cfstep));
+                cfr(ctx.x, 0, &ctx.limits, cfrcb_accept_simp, &ctx);
+                f = ctx.steps->t.convergent;
+            }
             if (ctx.is_welformed)
             {
                 printf("%lld / %lld\n", f.n, f.d);
@@ -917,14 +920,8 @@ int main(int argc, char ** argv)
         }
         break;
     case 'f':
-        {
-            char * fl = cf_convert_to_string_float(ctx.x, ctx.prints_float);
-            if (fl)
-            {
-                printf("%s\n", fl);
-                free(fl);
-            }
-        }
+        if (cf_write_float(stdout, ctx.x, ctx.prints_float) == 0)
+            printf("\n");
         break;
     case 'r':
         /* no break */
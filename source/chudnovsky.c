@@ -0,0 +1,319 @@
+/**
+ * continued fraction of pi by the series of Chudnovsky.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "common.h"
+#include "cf_mpz.h"
+
+/* bits of the first approximation, doubled at each refill */
+#define PI_START_BITS 1024
+
+/* terms of the approximation retrieved in a block */
+#define PI_BLOCK_TERMS 256
+
+/* bits of the precision not relied on, at least 5 */
+#define PI_GUARD_BITS 32
+
+/*
+ *            426880 sqrt(10005)
+ *     pi = ----------------------
+ *           sum_k  t(k)
+ *
+ *            (-1)^k (6k)! (13591409 + 545140134 k)
+ *     t(k) = -------------------------------------
+ *              (3k)! (k!)^3 640320^{3k}
+ *
+ * Each term adds about 14.18 decimal digits (47.11 bits).  The sum of
+ * terms [a, b) is split in halves, with
+ *
+ *     p(a, b) = p(a, m) p(m, b)
+ *     q(a, b) = q(a, m) q(m, b)
+ *     t(a, b) = t(a, m) q(m, b) + p(a, m) t(m, b)
+ *
+ * so that sum_{k<n} t(k) = t(0, n) / q(0, n) in integers of balanced
+ * sizes.
+ */
+static void chud_split(unsigned long a, unsigned long b,
+                       mpz_t p, mpz_t q, mpz_t t)
+{
+    if (b - a == 1)
+    {
+        if (a == 0)
+        {
+            mpz_set_ui(p, 1u);
+            mpz_set_ui(q, 1u);
+        }
+        else
+        {
+            mpz_set_ui(p, 6 * a - 5);
+            mpz_mul_ui(p, p, 2 * a - 1);
+            mpz_mul_ui(p, p, 6 * a - 1);
+            /* a^3 640320^3 / 24 */
+            mpz_set_ui(q, a);
+            mpz_mul_ui(q, q, a);
+            mpz_mul_ui(q, q, a);
+            mpz_mul_ui(q, q, 26680u);
+            mpz_mul_ui(q, q, 640320u);
+            mpz_mul_ui(q, q, 640320u);
+        }
+        mpz_set_ui(t, a);
+        mpz_mul_ui(t, t, 545140134u);
+        mpz_add_ui(t, t, 13591409u);
+        mpz_mul(t, t, p);
+        if (a & 1)
+            mpz_neg(t, t);
+    }
+    else
+    {
+        unsigned long m = a + (b - a) / 2;
+        mpz_t p1, q1, t1;
+
+        mpz_inits(p1, q1, t1, NULL);
+        chud_split(a, m, p, q, t);
+        chud_split(m, b, p1, q1, t1);
+        mpz_mul(t, t, q1);
+        mpz_addmul(t, p, t1);
+        mpz_mul(p, p, p1);
+        mpz_mul(q, q, q1);
+        mpz_clears(p1, q1, t1, NULL);
+    }
+}
+
+/*
+ * Set x to floor(pi 2^bits), short by less than 2.  The series is summed
+ * to a few bits beyond the precision, and the truncated square root and
+ * division are each less than an unit short.
+ */
+static void chud_pi_fixed(mpz_t x, unsigned long bits)
+{
+    unsigned long n = bits / 47 + 2;
+    mpz_t p, q, t;
+
+    mpz_inits(p, q, t, NULL);
+    chud_split(0, n, p, q, t);
+
+    mpz_set_ui(x, 10005u);
+    mpz_mul_2exp(x, x, 2 * bits);
+    mpz_sqrt(x, x);
+    mpz_mul(x, x, q);
+    mpz_mul_ui(x, x, 426880u);
+    mpz_fdiv_q(x, x, t);
+    mpz_clears(p, q, t, NULL);
+}
+
+static cf_class _pi_class;
+
+typedef struct _pi_cf pi_cf;
+struct _pi_cf {
+    cf base;
+    long long * terms;  /* the terms known for certain */
+    size_t n, cap, pos;
+    unsigned long bits;
+    int failed;
+};
+
+static int pi_push(pi_cf *pi, long long term)
+{
+    if (pi->n == pi->cap)
+    {
+        size_t cap = pi->cap ? pi->cap * 2 : 256;
+        long long * t = (long long*)realloc(pi->terms, cap * sizeof(long long));
+        if (!t)
+            return -1;
+        pi->terms = t;
+        pi->cap = cap;
+    }
+    pi->terms[pi->n++] = term;
+    return 0;
+}
+
+/*
+ * Work out the terms again at a precision for `want' terms at least,
+ * and twice the last one.
+ *
+ * |pi - x / 2^bits| < 2^{1-bits}, and the terms of x / 2^bits up to a_j
+ * are terms of pi while x is farther than that from the ends of the
+ * interval of numbers starting with a_0 ... a_j.  Both distances are
+ * more than 1 / (16 q_{j+1}^2 (a_{j+2} + 1)) for the denominator q_{j+1}
+ * of the convergent, so a_j is certain while
+ *
+ *     2 log2(q_{j+1}) + log2(a_{j+2} + 1) + 5 <= bits
+ *
+ * log2(q) is summed in double from q_{i+1} / q_i = a_{i+1} + q_{i-1} / q_i,
+ * with the ratio rounded up, and the guard bits cover the rounding.
+ */
+static void pi_refill(pi_cf *pi, size_t want)
+{
+    long long buf[PI_BLOCK_TERMS];
+    double lq = 0.0, r = 0.0;   /* log2(q_i) and q_{i-1} / q_i */
+    /* 3.5 bits a term, a little above the 3.42 of the theorem of Levy */
+    unsigned long bits = want / 2 * 7 + PI_GUARD_BITS;
+    mpz_t x, d;
+    cf * c;
+    size_t k, i;
+
+    pi->bits = pi->bits ? pi->bits * 2 : PI_START_BITS;
+    if (pi->bits < bits)
+        pi->bits = bits;
+    mpz_inits(x, d, NULL);
+    chud_pi_fixed(x, pi->bits);
+    mpz_set_ui(d, 1u);
+    mpz_mul_2exp(d, d, pi->bits);
+    c = cf_create_from_mpz_fraction(x, d);
+    mpz_clears(x, d, NULL);
+    if (!c)
+    {
+        pi->failed = 1;
+        return;
+    }
+
+    /* the known terms come out again first */
+    pi->n = 0;
+    while ((k = cf_next_terms(c, buf, PI_BLOCK_TERMS)) > 0)
+    {
+        for (i = 0; i < k; ++i)
+        {
+            /* buf[i] is a_{j+2}, and lq is log2(q_{j+1}) */
+            double a = (double)buf[i];
+            if (pi->n > 0 &&
+                2.0 * lq + log2(a + 1.0) + PI_GUARD_BITS > (double)pi->bits)
+                break;
+            if (pi_push(pi, buf[i]) != 0)
+            {
+                pi->failed = 1;
+                break;
+            }
+            if (pi->n > 1)
+            {
+                /* q_0 = 1, from a_1 on */
+                lq += log2(a + r);
+                r = 1.0 / (a + r) * (1.0 + 1e-12);
+            }
+        }
+        if (i < k)
+            break;
+    }
+    /* the last two pushed terms are a_{j+1} and a_{j+2} */
+    pi->n = pi->n > 2 ? pi->n - 2 : 0;
+    cf_free(c);
+}
+
+static long long pi_next_term(cf *c)
+{
+    pi_cf * pi = (pi_cf*) c;
+
+    while (pi->pos == pi->n && !pi->failed)
+    {
+        pi_refill(pi, pi->pos + 1);
+    }
+    if (pi->failed)
+        return LLONG_MAX;
+    return pi->terms[pi->pos++];
+}
+
+static int pi_is_finished(const cf *c)
+{
+    return ((const pi_cf*) c)->failed;
+}
+
+static size_t pi_next_terms(cf *c, long long *buf, size_t n)
+{
+    pi_cf * pi = (pi_cf*) c;
+    size_t i = 0;
+
+    while (i < n)
+    {
+        size_t len;
+
+        while (pi->pos == pi->n && !pi->failed)
+        {
+            pi_refill(pi, pi->pos + n - i);
+        }
+        if (pi->failed)
+            break;
+        len = pi->n - pi->pos;
+        if (len > n - i)
+            len = n - i;
+        memcpy(buf + i, pi->terms + pi->pos, len * sizeof(long long));
+        pi->pos += len;
+        i += len;
+    }
+    return i;
+}
+
+static void pi_free(cf *c)
+{
+    pi_cf * pi = (pi_cf*) c;
+    free(pi->terms);
+    free(pi);
+}
+
+static pi_cf * pi_alloc(void)
+{
+    pi_cf * pi = (pi_cf*)malloc(sizeof(pi_cf));
+    if (!pi)
+        return NULL;
+    pi->base.object_class = &_pi_class;
+    pi->terms = NULL;
+    pi->n = pi->cap = pi->pos = 0;
+    pi->bits = 0;
+    pi->failed = 0;
+    return pi;
+}
+
+static cf * pi_copy(const cf *c)
+{
+    const pi_cf * pi = (const pi_cf*) c;
+    pi_cf * copy = pi_alloc();
+
+    if (!copy)
+        return NULL;
+    if (pi->n)
+    {
+        copy->terms = (long long*)malloc(pi->n * sizeof(long long));
+        if (!copy->terms)
+        {
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy->terms, pi->terms, pi->n * sizeof(long long));
+    }
+    copy->n = copy->cap = pi->n;
+    copy->pos = pi->pos;
+    copy->bits = pi->bits;
+    copy->failed = pi->failed;
+    return &copy->base;
+}
+
+/*
+ * Work out the next n terms at once, instead of working them out again
+ * at a higher precision every time more are retrieved than are known.
+ */
+static void pi_reserve(cf *c, size_t n)
+{
+    pi_cf * pi = (pi_cf*) c;
+
+    if (!pi->failed && pi->n - pi->pos < n)
+        pi_refill(pi, pi->pos + n);
+}
+
+static cf_class _pi_class = {
+    pi_next_term,
+    pi_is_finished,
+    pi_free,
+    pi_copy,
+    pi_next_terms,
+    pi_reserve
+};
+
+cf * cf_create_from_pi(void)
+{
+    pi_cf * pi = pi_alloc();
+    return pi ? &pi->base : NULL;
+}
@@ -0,0 +1,379 @@
+/**
+ * coefficients of homographic engines in adaptive precision.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "common.h"
+#include "coefs.h"
+
+static void coefs_init_z(coefs *k)
+{
+    int i;
+    if (k->z_inited)
+        return;
+    for (i = 0; i < k->n; ++i)
+    {
+        mpz_init(k->z[i]);
+    }
+    mpz_init(k->t);
+    k->z_inited = 1;
+}
+
+#ifdef COEFS_HAVE_INT128
+static void mpz_set_i128(mpz_t z, __int128 v)
+{
+    unsigned __int128 u = v < 0 ? -(unsigned __int128)v : (unsigned __int128)v;
+    unsigned long long w[2];
+
+    w[0] = (unsigned long long)u;
+    w[1] = (unsigned long long)(u >> 64);
+    mpz_import(z, 2, -1, sizeof(w[0]), 0, 0, w);
+    if (v < 0)
+        mpz_neg(z, z);
+}
+
+static __int128 mpz_get_i128(const mpz_t z)
+{
+    unsigned long long w[2] = {0, 0};
+    unsigned __int128 u;
+
+    mpz_export(w, NULL, -1, sizeof(w[0]), 0, 0, z);
+    u = ((unsigned __int128)w[1] << 64) | w[0];
+    return mpz_sgn(z) < 0 ? -(__int128)u : (__int128)u;
+}
+
+static int bits_of_i128(__int128 v)
+{
+    unsigned __int128 u = v < 0 ? -(unsigned __int128)v : (unsigned __int128)v;
+    unsigned long long hi = (unsigned long long)(u >> 64);
+    unsigned long long lo = (unsigned long long)u;
+    if (hi)
+        return 128 - __builtin_clzll(hi);
+    return lo ? 64 - __builtin_clzll(lo) : 0;
+}
+#endif
+
+static int bits_of_ll(long long v)
+{
+    unsigned long long u = v < 0 ? -(unsigned long long)v : (unsigned long long)v;
+    return u ? 64 - __builtin_clzll(u) : 0;
+}
+
+static void coefs_promote(coefs *k)
+{
+    int i;
+#ifdef COEFS_HAVE_INT128
+    if (k->tier == COEFS_TIER_LL)
+    {
+        for (i = 0; i < k->n; ++i)
+        {
+            k->i128[i] = k->ll[i];
+        }
+        k->tier = COEFS_TIER_I128;
+        return;
+    }
+    coefs_init_z(k);
+    for (i = 0; i < k->n; ++i)
+    {
+        mpz_set_i128(k->z[i], k->i128[i]);
+    }
+#else
+    coefs_init_z(k);
+    for (i = 0; i < k->n; ++i)
+    {
+        mpz_set_ll(k->z[i], k->ll[i]);
+    }
+#endif
+    k->tier = COEFS_TIER_MPZ;
+}
+
+void coefs_init(coefs *k, int n, const long long *values,
+                unsigned long max_bits)
+{
+    int i;
+
+    k->tier = COEFS_TIER_LL;
+    k->n = n;
+    /* the native tiers always accept values of up to 126 bits */
+    k->max_bits = max_bits && max_bits < 127 ? 127 : max_bits;
+    for (i = 0; i < n; ++i)
+    {
+        k->ll[i] = values[i];
+    }
+    k->z_inited = 0;
+}
+
+void coefs_init_copy(coefs *k, const coefs *src)
+{
+    int i;
+
+    k->tier = src->tier;
+    k->n = src->n;
+    k->max_bits = src->max_bits;
+    k->z_inited = 0;
+    switch (src->tier)
+    {
+    case COEFS_TIER_LL:
+        memcpy(k->ll, src->ll, sizeof(k->ll));
+        break;
+#ifdef COEFS_HAVE_INT128
+    case COEFS_TIER_I128:
+        memcpy(k->i128, src->i128, sizeof(k->i128));
+        break;
+#endif
+    default:
+        coefs_init_z(k);
+        for (i = 0; i < k->n; ++i)
+        {
+            mpz_set(k->z[i], src->z[i]);
+        }
+        break;
+    }
+}
+
+void coefs_clear(coefs *k)
+{
+    int i;
+    if (!k->z_inited)
+        return;
+    for (i = 0; i < k->n; ++i)
+    {
+        mpz_clear(k->z[i]);
+    }
+    mpz_clear(k->t);
+    k->z_inited = 0;
+}
+
+int coefs_step_wide(coefs *k, const coefs_pair *pairs, int npairs,
+                    long long p, int sub)
+{
+    int i;
+
+    if (k->tier == COEFS_TIER_LL)
+    {
+        /* the inline step has overflowed */
+        coefs_promote(k);
+    }
+
+#ifdef COEFS_HAVE_INT128
+    if (k->tier == COEFS_TIER_I128)
+    {
+        __int128 r[COEFS_MAX];
+        int of = 0;
+
+        for (i = 0; i < npairs; ++i)
+        {
+            __int128 t;
+            of |= __builtin_mul_overflow(k->i128[pairs[i][0]], (__int128)p, &t);
+            if (sub)
+                of |= __builtin_sub_overflow(k->i128[pairs[i][1]], t, &r[i]);
+            else
+                of |= __builtin_add_overflow(k->i128[pairs[i][1]], t, &r[i]);
+        }
+        if (!of)
+        {
+            for (i = 0; i < npairs; ++i)
+            {
+                k->i128[pairs[i][1]] = k->i128[pairs[i][0]];
+                k->i128[pairs[i][0]] = r[i];
+            }
+            return 0;
+        }
+        coefs_promote(k);
+    }
+#endif
+
+    mpz_set_ll(k->t, p);
+    for (i = 0; i < npairs; ++i)
+    {
+        mpz_ptr zi = k->z[pairs[i][0]], zj = k->z[pairs[i][1]];
+        mpz_swap(zi, zj);
+        if (sub)
+            mpz_submul(zi, zj, k->t);
+        else
+            mpz_addmul(zi, zj, k->t);
+    }
+
+    if (k->max_bits)
+    {
+        for (i = 0; i < npairs; ++i)
+        {
+            if (mpz_sizeinbase(k->z[pairs[i][0]], 2) > k->max_bits)
+                break;
+        }
+        if (i < npairs)
+        {
+            /* roll back */
+            for (i = 0; i < npairs; ++i)
+            {
+                mpz_ptr zi = k->z[pairs[i][0]], zj = k->z[pairs[i][1]];
+                if (sub)
+                    mpz_addmul(zi, zj, k->t);
+                else
+                    mpz_submul(zi, zj, k->t);
+                mpz_swap(zi, zj);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int coefs_sgn_wide(const coefs *k, int i)
+{
+#ifdef COEFS_HAVE_INT128
+    if (k->tier == COEFS_TIER_I128)
+        return k->i128[i] > 0 ? 1 : k->i128[i] < 0 ? -1 : 0;
+#endif
+    if (k->tier == COEFS_TIER_LL)
+        return k->ll[i] > 0 ? 1 : k->ll[i] < 0 ? -1 : 0;
+    return mpz_sgn(k->z[i]);
+}
+
+long long coefs_quot_wide(coefs *k, int i, int j, int *exact)
+{
+    *exact = 1;
+    switch (k->tier)
+    {
+    case COEFS_TIER_LL:
+        if (k->ll[i] == LLONG_MIN && k->ll[j] == -1ll)
+        {
+            *exact = 0;
+            return LLONG_MAX;
+        }
+        return k->ll[i] / k->ll[j];
+#ifdef COEFS_HAVE_INT128
+    case COEFS_TIER_I128:
+        {
+            __int128 q;
+            if (k->i128[j] == -1)
+                q = -k->i128[i];
+            else
+                q = k->i128[i] / k->i128[j];
+            if (q > LLONG_MAX)
+            {
+                *exact = 0;
+                return LLONG_MAX;
+            }
+            if (q < LLONG_MIN)
+            {
+                *exact = 0;
+                return LLONG_MIN;
+            }
+            return (long long)q;
+        }
+#endif
+    default:
+        mpz_tdiv_q(k->t, k->z[i], k->z[j]);
+        if (mpz_sizeinbase(k->t, 2) > 63)
+        {
+            *exact = 0;
+            return mpz_sgn(k->t) > 0 ? LLONG_MAX : LLONG_MIN;
+        }
+        return mpz_get_ll(k->t);
+    }
+}
+
+void coefs_set_wide(coefs *k, int i, int j)
+{
+    switch (k->tier)
+    {
+    case COEFS_TIER_LL:
+        k->ll[i] = k->ll[j];
+        break;
+#ifdef COEFS_HAVE_INT128
+    case COEFS_TIER_I128:
+        k->i128[i] = k->i128[j];
+        break;
+#endif
+    default:
+        mpz_set(k->z[i], k->z[j]);
+        break;
+    }
+}
+
+void coefs_zero_wide(coefs *k, int i)
+{
+    switch (k->tier)
+    {
+    case COEFS_TIER_LL:
+        k->ll[i] = 0ll;
+        break;
+#ifdef COEFS_HAVE_INT128
+    case COEFS_TIER_I128:
+        k->i128[i] = 0;
+        break;
+#endif
+    default:
+        mpz_set_ui(k->z[i], 0u);
+        break;
+    }
+}
+
+unsigned long coefs_bits(const coefs *k)
+{
+    unsigned long bits = 0, b;
+    int i;
+
+    for (i = 0; i < k->n; ++i)
+    {
+        switch (k->tier)
+        {
+        case COEFS_TIER_LL:
+            b = bits_of_ll(k->ll[i]);
+            break;
+#ifdef COEFS_HAVE_INT128
+        case COEFS_TIER_I128:
+            b = bits_of_i128(k->i128[i]);
+            break;
+#endif
+        default:
+            b = mpz_sgn(k->z[i]) ? mpz_sizeinbase(k->z[i], 2) : 0;
+            break;
+        }
+        if (b > bits)
+            bits = b;
+    }
+    return bits;
+}
+
+/*
+ * Move the coefficients down to the narrowest tier they fit in.
+ */
+void coefs_demote(coefs *k)
+{
+    unsigned long bits;
+    int i;
+
+    if (k->tier == COEFS_TIER_LL)
+        return;
+
+    bits = coefs_bits(k);
+    if (bits <= 63)
+    {
+        for (i = 0; i < k->n; ++i)
+        {
+#ifdef COEFS_HAVE_INT128
+            if (k->tier == COEFS_TIER_I128)
+                k->ll[i] = (long long)k->i128[i];
+            else
+#endif
+                k->ll[i] = mpz_get_ll(k->z[i]);
+        }
+        k->tier = COEFS_TIER_LL;
+    }
+#ifdef COEFS_HAVE_INT128
+    else if (bits <= 126 && k->tier == COEFS_TIER_MPZ)
+    {
+        for (i = 0; i < k->n; ++i)
+        {
+            k->i128[i] = mpz_get_i128(k->z[i]);
+        }
+        k->tier = COEFS_TIER_I128;
+    }
+#endif
+}
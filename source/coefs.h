@@ -0,0 +1,176 @@
+/*
+ * Coefficients of homographic engines in adaptive precision.
+ *
+ * The coefficients are kept in long long while they fit, promoted to
+ * __int128 (where the compiler has it) and then to mpz when a checked
+ * operation overflows, and demoted again on request when they shrink.
+ *
+ * All updates of an engine are expressed as pair steps:
+ *
+ *     (k[i], k[j]) <- (k[j] + k[i] * p, k[i])    (coefs_step)
+ *     (k[i], k[j]) <- (k[j] - k[i] * p, k[i])    (coefs_step_sub)
+ *
+ * Ingesting an input term p into ax + b is the step on (a, b), and
+ * emitting a term q of (ax + b) / (cx + d) is the step_sub on (c, a)
+ * and on (d, b).
+ *
+ * \date   2026-10-17
+ */
+#ifndef __COEFS_H__
+#define __COEFS_H__
+
+#include <limits.h>
+#include <gmp.h>
+
+#if defined(__SIZEOF_INT128__)
+#define COEFS_HAVE_INT128 1
+#endif
+
+#define COEFS_MAX 8
+
+enum {
+    COEFS_TIER_LL = 0,
+    COEFS_TIER_I128,
+    COEFS_TIER_MPZ
+};
+
+typedef struct _coefs coefs;
+struct _coefs {
+    int tier;
+    int n;
+    unsigned long max_bits;     /* 0 for unlimited */
+    long long ll[COEFS_MAX];
+#ifdef COEFS_HAVE_INT128
+    __int128 i128[COEFS_MAX];
+#endif
+    int z_inited;               /* z and t are initialised lazily */
+    mpz_t z[COEFS_MAX];
+    mpz_t t;
+};
+
+/* a pair of coefficient indexes (i, j) for coefs_step() */
+typedef unsigned char coefs_pair[2];
+
+void coefs_init(coefs *k, int n, const long long *values,
+                unsigned long max_bits);
+void coefs_init_copy(coefs *k, const coefs *src);
+void coefs_clear(coefs *k);
+
+int coefs_step_wide(coefs *k, const coefs_pair *pairs, int npairs,
+                    long long p, int sub);
+int coefs_sgn_wide(const coefs *k, int i);
+long long coefs_quot_wide(coefs *k, int i, int j, int *exact);
+void coefs_set_wide(coefs *k, int i, int j);
+void coefs_zero_wide(coefs *k, int i);
+void coefs_demote(coefs *k);
+unsigned long coefs_bits(const coefs *k);
+
+/*
+ * Apply a pair step to every pair, with checked arithmetic.
+ *
+ * Returns 0 on success, or -1 if the result would exceed max_bits, in
+ * which case k is left unchanged.
+ */
+static inline
+int coefs_step_op(coefs *k, const coefs_pair *pairs, int npairs,
+                  long long p, int sub)
+{
+    if (k->tier == COEFS_TIER_LL)
+    {
+        long long r[COEFS_MAX];
+        int i, of = 0;
+
+        for (i = 0; i < npairs; ++i)
+        {
+            long long t;
+            of |= __builtin_mul_overflow(k->ll[pairs[i][0]], p, &t);
+            if (sub)
+                of |= __builtin_sub_overflow(k->ll[pairs[i][1]], t, &r[i]);
+            else
+                of |= __builtin_add_overflow(k->ll[pairs[i][1]], t, &r[i]);
+        }
+        if (!of)
+        {
+            for (i = 0; i < npairs; ++i)
+            {
+                k->ll[pairs[i][1]] = k->ll[pairs[i][0]];
+                k->ll[pairs[i][0]] = r[i];
+            }
+            return 0;
+        }
+    }
+    return coefs_step_wide(k, pairs, npairs, p, sub);
+}
+
+static inline
+int coefs_step(coefs *k, const coefs_pair *pairs, int npairs, long long p)
+{
+    return coefs_step_op(k, pairs, npairs, p, 0);
+}
+
+static inline
+int coefs_step_sub(coefs *k, const coefs_pair *pairs, int npairs, long long p)
+{
+    return coefs_step_op(k, pairs, npairs, p, 1);
+}
+
+/*
+ * Sign of k[i].
+ */
+static inline
+int coefs_sgn(const coefs *k, int i)
+{
+    if (k->tier == COEFS_TIER_LL)
+        return k->ll[i] > 0 ? 1 : k->ll[i] < 0 ? -1 : 0;
+    return coefs_sgn_wide(k, i);
+}
+
+static inline
+int coefs_is_zero(const coefs *k, int i)
+{
+    return coefs_sgn(k, i) == 0;
+}
+
+/*
+ * Truncated quotient k[i] / k[j] (k[j] != 0).
+ *
+ * A quotient out of the range of long long is saturated to LLONG_MAX or
+ * LLONG_MIN, and *exact is cleared.
+ */
+static inline
+long long coefs_quot(coefs *k, int i, int j, int *exact)
+{
+    if (k->tier == COEFS_TIER_LL &&
+        !(k->ll[i] == LLONG_MIN && k->ll[j] == -1ll))
+    {
+        *exact = 1;
+        return k->ll[i] / k->ll[j];
+    }
+    return coefs_quot_wide(k, i, j, exact);
+}
+
+/*
+ * k[i] = k[j]
+ */
+static inline
+void coefs_set(coefs *k, int i, int j)
+{
+    if (k->tier == COEFS_TIER_LL)
+        k->ll[i] = k->ll[j];
+    else
+        coefs_set_wide(k, i, j);
+}
+
+/*
+ * k[i] = 0
+ */
+static inline
+void coefs_zero(coefs *k, int i)
+{
+    if (k->tier == COEFS_TIER_LL)
+        k->ll[i] = 0ll;
+    else
+        coefs_zero_wide(k, i);
+}
+
+#endif // __COEFS_H__
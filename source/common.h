@@ -1,5 +1,9 @@
+#include <limits.h>
+#include <string.h>
 #include <gmp.h>
 
+#include "cf.h"
+
 void mpz_set_ull (mpz_t z, unsigned long long ull);
 
 unsigned long long mpz_get_ull(mpz_t z);
@@ -7,3 +11,130 @@ unsigned long long mpz_get_ull(mpz_t z);
 void mpz_set_ll(mpz_t z, long long sll);
 
 long long mpz_get_ll(mpz_t z);
+
+/*
+ * Block of terms pulled in advance from an input continued fraction.
+ *
+ * Engines taking continued fractions as input read them through a
+ * block, so that a chained input pays one `cf_next_terms()' call per
+ * block instead of one indirect call per term.  The block size starts
+ * at 1 and doubles up to CF_TERM_BLOCK_SIZE, so that an engine which
+ * only needs a few terms does not make its input compute many more.
+ */
+#define CF_TERM_BLOCK_SIZE 32
+
+typedef struct _cf_term_block cf_term_block;
+struct _cf_term_block {
+    unsigned int pos, len, want;
+    long long terms[CF_TERM_BLOCK_SIZE];
+};
+
+static inline void cf_term_block_init(cf_term_block *b)
+{
+    b->pos = b->len = 0;
+    b->want = 1;
+}
+
+/*
+ * Retrieve next term of x through the block, LLONG_MAX if finished.
+ */
+static inline long long cf_term_block_next(cf_term_block *b, cf *x)
+{
+    if (b->pos == b->len)
+    {
+        b->pos = 0;
+        b->len = cf_next_terms(x, b->terms, b->want);
+        if (b->want < CF_TERM_BLOCK_SIZE)
+            b->want <<= 1;
+        if (!b->len)
+            return LLONG_MAX;
+    }
+    return b->terms[b->pos++];
+}
+
+/*
+ * Check whether x is finished and no term is left in the block.
+ */
+static inline int cf_term_block_is_finished(const cf_term_block *b,
+                                            const cf *x)
+{
+    return b->pos == b->len && cf_is_finished(x);
+}
+
+/*
+ * Put x on a tape shared by its copies, unless it is already on one.
+ *
+ * Engines call it on their inputs when they are copied, so that a copy
+ * of an expression shares the terms of the inputs instead of copying
+ * them all the way down, and the terms are worked out once for all the
+ * copies.  x is left as it is if the tape can not be made.
+ *
+ * The copy functions cast the const of their source away for it, so a
+ * copy is not read-only, and the tape is not locked: the cursors of a
+ * tape are read from one thread at a time.  Its counts are atomic, as
+ * those of the other shared terms, so that the cursors can be freed on
+ * different threads.
+ */
+void cf_tape_share(cf **x);
+
+/*
+ * Output to a sink in blocks of CF_WRITE_BLOCK bytes, so that a long
+ * output is never held in memory as a whole (the numbers it is made from
+ * may be, see cf_write_float_to()).  After a failure of the sink, the
+ * output is dropped and cf_writer_flush() returns -1.
+ */
+#define CF_WRITE_BLOCK 4096
+
+typedef struct _cf_writer cf_writer;
+struct _cf_writer {
+    cf_sink sink;
+    void * data;
+    size_t len;
+    int error;
+    char buf[CF_WRITE_BLOCK];
+};
+
+void cf_writer_init(cf_writer *w, cf_sink sink, void *data);
+void cf_writer_put(cf_writer *w, const char *s, size_t n);
+int cf_writer_flush(cf_writer *w);
+
+static inline void cf_writer_puts(cf_writer *w, const char *s)
+{
+    cf_writer_put(w, s, strlen(s));
+}
+
+/*
+ * A growing '\0' terminated string, as the data of cf_string_sink().
+ */
+typedef struct _cf_string cf_string;
+struct _cf_string {
+    char * s;
+    size_t len, cap;
+};
+
+int cf_string_sink(const char *buf, size_t len, void *data);
+
+/*
+ * A sink writing to the FILE * given as its data.
+ */
+int cf_file_sink(const char *buf, size_t len, void *data);
+
+/*
+ * Write the decimal string of c by the digit generator, as
+ * cf_convert_to_string_float() makes it.
+ */
+void cf_digit_gen_write_float(cf_writer *w, const cf *c, int max_digits);
+
+/*
+ * Products of the matrices [t_i 1; 1 0] of terms, [m[0] m[1]; m[2] m[3]]
+ * in GMP integers.
+ *
+ * cf_matrix_mul() sets m = m * m1, with t as a temporary.
+ * cf_matrix_product() sets m = [p_{n-1} p_{n-2}; q_{n-1} q_{n-2}] for the
+ * n terms t, by a balanced product tree, and cf_matrix_product_threads()
+ * works out the subtrees on up to `threads' threads.
+ */
+void cf_matrix_mul(mpz_t *m, mpz_t *m1, mpz_t t);
+void cf_matrix_product(const long long *t, size_t n, mpz_t *m, mpz_t tmp);
+void cf_matrix_product_threads(const long long *t, size_t n, mpz_t *m,
+                               int threads);
@@ -3,6 +3,7 @@
 #include <limits.h>
 
 #include "cf.h"
+#include "common.h"
 
 typedef struct _cf_converg_gen_priv cf_converg_gen_priv;
 struct _cf_converg_gen_priv {
@@ -74,6 +75,7 @@ cf_converg_gen * cf_converg_gen_copy(const cf_converg_gen * approx)
         return NULL;
 
     memcpy(s, approx, sizeof(cf_converg_gen_priv));
+    cf_tape_share(&((cf_converg_gen_priv *)approx)->c);
     s->c = cf_copy(((const cf_converg_gen_priv *)approx)->c);
     return &s->base;
 }
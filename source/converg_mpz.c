@@ -0,0 +1,205 @@
+/**
+ * convergents of continued fractions in GMP integers.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cf.h"
+#include "common.h"
+#include "cf_mpz.h"
+
+/*
+ * p_{k+1} = a_{k+1} p_k + p_{k-1}, and the same for q.  The convergents
+ * k - 1, k and k + 1 are in three slots used in turn, so the integers of
+ * the slot of k - 2 take the next one and no integer is allocated once
+ * they have room.
+ */
+typedef struct _converg_mpz converg_mpz;
+struct _converg_mpz {
+    cf_converg_mpz_gen base;
+    cf * c;
+    cf_term_block cb;
+    mpz_t p[3], q[3];
+    size_t bits[3];     /* room of the integers of a slot */
+    mpz_t t;
+    long long coef;     /* a_k */
+    int k;              /* the slot of convergent k */
+    int finished;
+    cf_converg_mpz_term term;
+};
+
+/*
+ * Make room in the slot for integers of `need' bits, twice as much as
+ * needed when it grows, so that it grows a few times in all.
+ */
+static void converg_mpz_reserve(converg_mpz *g, int slot, size_t need)
+{
+    if (need > g->bits[slot])
+    {
+        g->bits[slot] = 2 * need;
+        mpz_realloc2(g->p[slot], g->bits[slot]);
+        mpz_realloc2(g->q[slot], g->bits[slot]);
+    }
+}
+
+/*
+ * Retrieve the next term, or LLONG_MAX at the end of the CF.
+ */
+static long long converg_mpz_next_coef(converg_mpz *g)
+{
+    if (cf_term_block_is_finished(&g->cb, g->c))
+        return LLONG_MAX;
+    return cf_term_block_next(&g->cb, g->c);
+}
+
+static const cf_converg_mpz_term * converg_mpz_next_term(cf_converg_mpz_gen *approx)
+{
+    converg_mpz * g = (converg_mpz*) approx;
+    int k = g->k, k1 = (k + 1) % 3, k0 = (k + 2) % 3;
+    size_t need;
+    long long a;
+
+    if (g->finished)
+        return NULL;
+
+    g->term.coef = g->coef;
+    g->term.p = g->p[k];
+    g->term.q = g->q[k];
+
+    a = converg_mpz_next_coef(g);
+    if (a == LLONG_MAX)
+    {
+        g->term.q_next = NULL;
+        g->term.exact = 1;
+        g->finished = 1;
+        return &g->term;
+    }
+
+    /* a_{k+1} p_k + p_{k-1} has at most 64 bits more than p_k */
+    need = mpz_sizeinbase(g->p[k], 2);
+    if (need < mpz_sizeinbase(g->q[k], 2))
+        need = mpz_sizeinbase(g->q[k], 2);
+    converg_mpz_reserve(g, k1, need + 65);
+    mpz_set_ll(g->t, a);
+    mpz_set(g->p[k1], g->p[k0]);
+    mpz_addmul(g->p[k1], g->p[k], g->t);
+    mpz_set(g->q[k1], g->q[k0]);
+    mpz_addmul(g->q[k1], g->q[k], g->t);
+    g->coef = a;
+    g->k = k1;
+
+    g->term.q_next = g->q[k1];
+    g->term.exact = 0;
+    return &g->term;
+}
+
+static int converg_mpz_is_finished(const cf_converg_mpz_gen *approx)
+{
+    return ((const converg_mpz*) approx)->finished;
+}
+
+static void converg_mpz_free(cf_converg_mpz_gen *approx)
+{
+    converg_mpz * g = (converg_mpz*) approx;
+    cf_free(g->c);
+    mpz_clears(g->p[0], g->p[1], g->p[2], g->q[0], g->q[1], g->q[2], g->t,
+               NULL);
+    free(g);
+}
+
+static cf_converg_mpz_gen_class _converg_mpz_class;
+
+static converg_mpz * converg_mpz_alloc(cf *c)
+{
+    converg_mpz * g = (converg_mpz*)malloc(sizeof(converg_mpz));
+
+    if (!g)
+        return NULL;
+    g->base.object_class = &_converg_mpz_class;
+    g->c = c;
+    mpz_inits(g->p[0], g->p[1], g->p[2], g->q[0], g->q[1], g->q[2], g->t,
+              NULL);
+    g->bits[0] = g->bits[1] = g->bits[2] = 0;
+    memset(&g->term, 0, sizeof(g->term));
+    return g;
+}
+
+static cf_converg_mpz_gen * converg_mpz_copy(const cf_converg_mpz_gen *approx)
+{
+    converg_mpz * g = (converg_mpz*) approx;
+    converg_mpz * copy;
+    cf * c;
+    int i;
+
+    cf_tape_share(&g->c);
+    c = cf_copy(g->c);
+    if (!c)
+        return NULL;
+    copy = converg_mpz_alloc(c);
+    if (!copy)
+    {
+        cf_free(c);
+        return NULL;
+    }
+    for (i = 0; i < 3; ++i)
+    {
+        converg_mpz_reserve(copy, i, g->bits[i]);
+        mpz_set(copy->p[i], g->p[i]);
+        mpz_set(copy->q[i], g->q[i]);
+    }
+    copy->cb = g->cb;
+    copy->coef = g->coef;
+    copy->k = g->k;
+    copy->finished = g->finished;
+    return &copy->base;
+}
+
+static cf_converg_mpz_gen_class _converg_mpz_class = {
+    converg_mpz_next_term,
+    converg_mpz_is_finished,
+    converg_mpz_free,
+    converg_mpz_copy
+};
+
+cf_converg_mpz_gen * cf_converg_mpz_gen_create(const cf * c)
+{
+    cf * x = cf_copy(c);
+    converg_mpz * g;
+
+    if (!x)
+        return NULL;
+    g = converg_mpz_alloc(x);
+    if (!g)
+    {
+        cf_free(x);
+        return NULL;
+    }
+    cf_term_block_init(&g->cb);
+
+    /* p_{-1} / q_{-1} = 1 / 0, and p_0 / q_0 = a0 / 1 */
+    g->k = 1;
+    mpz_set_ui(g->p[0], 1u);
+    mpz_set_ui(g->q[0], 0u);
+    g->coef = converg_mpz_next_coef(g);
+    g->finished = g->coef == LLONG_MAX;
+    mpz_set_ll(g->p[1], g->coef);
+    mpz_set_ui(g->q[1], 1u);
+    return &g->base;
+}
+
+void cf_converg_mpz_term_errors(const cf_converg_mpz_term * term,
+                                mpz_t lower, mpz_t upper)
+{
+    if (term->exact)
+    {
+        mpz_set_ui(lower, 0u);
+        mpz_set_ui(upper, 0u);
+        return;
+    }
+    mpz_mul(upper, term->q, term->q_next);
+    mpz_mul(lower, term->q, term->q);
+    mpz_add(lower, lower, upper);
+}
@@ -61,6 +61,159 @@ cf * cf_create_from_float(double d)
     return ret;
 }
 
+/*
+ * A double m 2^-s with m < 2^53 is worked out exactly for s up to
+ * BATCH_MAX_SHIFT in 128 bits.  Below 2^-64, 0/1 is closer than any
+ * 1/q with q < 2^63.
+ */
+#define BATCH_MAX_SHIFT 117
+
+typedef unsigned __int128 batch_u128;
+
+/*
+ * Check whether u / v > c / d, for u / v with v = 0 taken as infinite,
+ * by comparing the integer parts in the way of the Euclidean algorithm.
+ */
+static int batch_greater(batch_u128 u, batch_u128 v,
+                         unsigned long long c, unsigned long long d)
+{
+    int greater = 1;    /* checking u / v > c / d, or u / v < c / d */
+
+    for (;;)
+    {
+        batch_u128 a, r;
+        unsigned long long b, t;
+
+        if (v == 0)
+            return d ? greater : 0;
+        if (d == 0)
+            return !greater;
+        a = u / v;
+        b = c / d;
+        if (a != b)
+            return (a > b) == greater;
+        r = u - a * v;
+        t = c - b * d;
+        u = v;
+        v = r;
+        c = d;
+        d = t;
+        greater = !greater;
+    }
+}
+
+/*
+ * The best fraction of u / v >= 0 with a denominator up to maxden, as
+ * rational_best_with_bound() finds it, with the numerator in long long.
+ * A division per term is cheaper than subtracting the small quotients,
+ * whose branches the processor can not predict.
+ */
+static fraction batch_best(batch_u128 u, batch_u128 v,
+                           unsigned long long maxden)
+{
+    unsigned long long pm = 0, qm = 1, pk = 1, qk = 0;
+    unsigned long long jd, jn, j;
+    batch_u128 a, r;
+
+    while (v)
+    {
+        if ((u | v) >> 64)
+        {
+            a = u / v;
+            r = u - a * v;
+        }
+        else
+        {
+            /* a division of the machine once the numbers are short */
+            a = (unsigned long long)u / (unsigned long long)v;
+            r = (unsigned long long)u % (unsigned long long)v;
+        }
+
+        jd = qk ? (maxden - qm) / qk : ULLONG_MAX;
+        jn = pk ? ((unsigned long long)LLONG_MAX - pm) / pk : ULLONG_MAX;
+        j = jd < jn ? jd : jn;
+        if (j >= a)
+        {
+            unsigned long long p = (unsigned long long)a * pk + pm;
+            unsigned long long q = (unsigned long long)a * qk + qm;
+            pm = pk;
+            qm = qk;
+            pk = p;
+            qk = q;
+            u = v;
+            v = r;
+            continue;
+        }
+
+        /* the rest is y' = v / r, and the choice is that of cf.c */
+        if (qk == 0 ||
+            (j > 0 && (2 * (batch_u128)j > a ||
+                       (2 * (batch_u128)j == a &&
+                        batch_greater(v, r, qk, qm)))))
+            return (fraction){j * pk + pm, j * qk + qm};
+        return (fraction){pk, qk};
+    }
+    return (fraction){pk, qk};
+}
+
+void rational_best_batch(const double *in, fraction *out, size_t n,
+                         long long maxden)
+{
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        unsigned long long bits, m;
+        int e, s, tz;
+        fraction f;
+
+        memcpy(&bits, &in[i], sizeof(bits));
+        e = (int)(bits >> 52 & 0x7ff);
+        m = bits & 0x000fffffffffffffull;
+
+        if (maxden < 1)
+        {
+            f = (fraction){0ll, 0ll};
+        }
+        else if (e == 0x7ff)
+        {
+            /* infinite, or NaN */
+            f = (fraction){m ? 0ll : 1ll, 0ll};
+        }
+        else if (e == 0)
+        {
+            /* zero, or subnormal far below 2^-64 */
+            f = (fraction){0ll, 1ll};
+        }
+        else
+        {
+            /* |x| = m 2^-s, with m odd if s > 0 */
+            m |= 0x0010000000000000ull;
+            s = 1075 - e;
+            if (s > 0)
+            {
+                tz = __builtin_ctzll(m);
+                tz = tz < s ? tz : s;
+                m >>= tz;
+                s -= tz;
+            }
+
+            if (s <= 0)
+                f = -s <= 10 ? (fraction){(long long)(m << -s), 1ll}
+                             : (fraction){LLONG_MAX, 1ll};
+            else if (s > BATCH_MAX_SHIFT)
+                f = (fraction){0ll, 1ll};
+            else
+                f = batch_best(m, (batch_u128)1 << s,
+                               (unsigned long long)maxden);
+        }
+
+        if (bits >> 63)
+            f.n = -f.n;
+        out[i] = f;
+    }
+}
+
 typedef struct _gcf_float_str {
     gcf base;
     char * str;
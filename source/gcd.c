@@ -0,0 +1,231 @@
+/**
+ * greatest common divisors of long long integers.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cf.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define GCD_HAVE_X86_SIMD 1
+#endif
+
+/*
+ * Binary gcd of Stein, on magnitudes.
+ */
+static inline unsigned long long gcd_binary(unsigned long long u,
+                                            unsigned long long v)
+{
+    int k;
+
+    if (u == 0)
+        return v;
+    if (v == 0)
+        return u;
+
+    k = __builtin_ctzll(u | v);
+    u >>= __builtin_ctzll(u);
+    v >>= __builtin_ctzll(v);
+    while (u != v)
+    {
+        /*
+         * both are odd: (u, v) <- (|u - v| without trailing zeros,
+         * min(u, v)).  ctz(u - v) == ctz(|u - v|), so the count does not
+         * wait for the absolute value.
+         */
+        unsigned long long d = u - v;
+        int z = __builtin_ctzll(d);
+        v = u < v ? u : v;
+        u = (u > v ? d : -d) >> z;
+    }
+    return u << k;
+}
+
+static inline unsigned long long gcd_abs(long long a)
+{
+    return a < 0 ? -(unsigned long long)a : (unsigned long long)a;
+}
+
+long long cf_get_gcd(long long a, long long b)
+{
+    return (long long)gcd_binary(gcd_abs(a), gcd_abs(b));
+}
+
+static void gcd_batch_scalar(const long long *a, const long long *b,
+                             long long *out, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; ++i)
+    {
+        out[i] = (long long)gcd_binary(gcd_abs(a[i]), gcd_abs(b[i]));
+    }
+}
+
+#ifdef GCD_HAVE_X86_SIMD
+
+/*
+ * 4 pairs in a step.
+ *
+ * AVX2 has no count of trailing zeros of 64-bit lanes: the lowest set
+ * bit is converted to float to read its index from the exponent.
+ */
+__attribute__((target("avx2")))
+static inline __m256i gcd_ctz_avx2(__m256i x)
+{
+    const __m256i lo32 = _mm256_set1_epi64x(0xffffffffll);
+    __m256i y = _mm256_and_si256(x, _mm256_sub_epi64(_mm256_setzero_si256(), x));
+    __m256i e = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(y)), 23);
+    __m256i elo, ehi, lowzero;
+
+    e = _mm256_and_si256(e, _mm256_set1_epi32(0xff));
+    elo = _mm256_sub_epi64(_mm256_and_si256(e, lo32), _mm256_set1_epi64x(127));
+    ehi = _mm256_sub_epi64(_mm256_srli_epi64(e, 32), _mm256_set1_epi64x(127 - 32));
+    lowzero = _mm256_cmpeq_epi64(_mm256_and_si256(y, lo32), _mm256_setzero_si256());
+    return _mm256_blendv_epi8(elo, ehi, lowzero);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i gcd_abs_avx2(__m256i x)
+{
+    __m256i s = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+    return _mm256_sub_epi64(_mm256_xor_si256(x, s), s);
+}
+
+__attribute__((target("avx2")))
+static void gcd_batch_avx2(const long long *a, const long long *b,
+                           long long *out, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256i u = gcd_abs_avx2(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m256i v = gcd_abs_avx2(_mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i uz = _mm256_cmpeq_epi64(u, zero);
+        __m256i active, k;
+
+        /* gcd(0, v) = v and gcd(u, 0) = u: move it to u, leave v 0 */
+        u = _mm256_blendv_epi8(u, v, uz);
+        v = _mm256_andnot_si256(uz, v);
+        active = _mm256_xor_si256(_mm256_cmpeq_epi64(v, zero),
+                                  _mm256_set1_epi64x(-1));
+
+        k = _mm256_and_si256(gcd_ctz_avx2(_mm256_or_si256(u, v)), active);
+        u = _mm256_blendv_epi8(u, _mm256_srlv_epi64(u, gcd_ctz_avx2(u)), active);
+        v = _mm256_blendv_epi8(v, _mm256_srlv_epi64(v, gcd_ctz_avx2(v)), active);
+        active = _mm256_andnot_si256(_mm256_cmpeq_epi64(u, v), active);
+
+        /* odd u, v below 2^63 from now on, signed compares are fine */
+        while (!_mm256_testz_si256(active, active))
+        {
+            __m256i d = _mm256_sub_epi64(u, v);
+            __m256i z = gcd_ctz_avx2(d);
+            __m256i neg = _mm256_cmpgt_epi64(v, u);
+            __m256i mn = _mm256_blendv_epi8(v, u, neg);
+
+            d = _mm256_sub_epi64(_mm256_xor_si256(d, neg), neg);
+            u = _mm256_blendv_epi8(u, _mm256_srlv_epi64(d, z), active);
+            v = _mm256_blendv_epi8(v, mn, active);
+            active = _mm256_andnot_si256(_mm256_cmpeq_epi64(u, v), active);
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sllv_epi64(u, k));
+    }
+    gcd_batch_scalar(a + i, b + i, out + i, n - i);
+}
+
+/*
+ * 8 pairs in a step, with vplzcntq of AVX-512CD for trailing zeros and
+ * the unsigned min/max of AVX-512F.
+ */
+__attribute__((target("avx512f,avx512cd")))
+static inline __m512i gcd_ctz_avx512(__m512i x)
+{
+    __m512i y = _mm512_and_si512(x, _mm512_sub_epi64(_mm512_setzero_si512(), x));
+    return _mm512_sub_epi64(_mm512_set1_epi64(63), _mm512_lzcnt_epi64(y));
+}
+
+__attribute__((target("avx512f,avx512cd")))
+static void gcd_batch_avx512(const long long *a, const long long *b,
+                             long long *out, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512i u = _mm512_abs_epi64(_mm512_loadu_si512(a + i));
+        __m512i v = _mm512_abs_epi64(_mm512_loadu_si512(b + i));
+        __mmask8 uz = _mm512_cmpeq_epi64_mask(u, zero);
+        __mmask8 active;
+        __m512i k;
+
+        /* gcd(0, v) = v and gcd(u, 0) = u: move it to u, leave v 0 */
+        u = _mm512_mask_mov_epi64(u, uz, v);
+        v = _mm512_mask_mov_epi64(v, uz, zero);
+        active = _mm512_cmpneq_epi64_mask(v, zero);
+
+        k = _mm512_maskz_mov_epi64(active, gcd_ctz_avx512(_mm512_or_si512(u, v)));
+        u = _mm512_mask_srlv_epi64(u, active, u, gcd_ctz_avx512(u));
+        v = _mm512_mask_srlv_epi64(v, active, v, gcd_ctz_avx512(v));
+        active = _mm512_mask_cmpneq_epi64_mask(active, u, v);
+
+        while (active)
+        {
+            __m512i d = _mm512_sub_epi64(u, v);
+            __m512i z = gcd_ctz_avx512(d);
+
+            v = _mm512_mask_min_epu64(v, active, u, v);
+            u = _mm512_mask_srlv_epi64(u, active, _mm512_abs_epi64(d), z);
+            active = _mm512_mask_cmpneq_epi64_mask(active, u, v);
+        }
+        _mm512_storeu_si512(out + i, _mm512_sllv_epi64(u, k));
+    }
+    gcd_batch_scalar(a + i, b + i, out + i, n - i);
+}
+
+#endif /* GCD_HAVE_X86_SIMD */
+
+typedef void (*gcd_batch_func)(const long long *a, const long long *b,
+                               long long *out, size_t n);
+
+/*
+ * Choose the widest kernel the cpu supports, once.  The environment
+ * variable CF_GCD_ISA can force a narrower one: "scalar", or "avx2" to
+ * leave AVX-512 out.  Other values are ignored.
+ */
+static gcd_batch_func gcd_batch_select(void)
+{
+    static gcd_batch_func func = NULL;
+    const char * isa;
+
+    if (func)
+        return func;
+
+    isa = getenv("CF_GCD_ISA");
+    func = gcd_batch_scalar;
+#ifdef GCD_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (isa && strcmp(isa, "scalar") == 0)
+        ;
+    else if (__builtin_cpu_supports("avx512f") &&
+             __builtin_cpu_supports("avx512cd") &&
+             !(isa && strcmp(isa, "avx2") == 0))
+        func = gcd_batch_avx512;
+    else if (__builtin_cpu_supports("avx2"))
+        func = gcd_batch_avx2;
+#else
+    (void)isa;
+#endif
+    return func;
+}
+
+void cf_get_gcd_batch(const long long *a, const long long *b,
+                      long long *out, size_t n)
+{
+    gcd_batch_select()(a, b, out, n);
+}
@@ -75,22 +75,44 @@ gcf * gcf_create_from_pairs(const number_pair * arr, unsigned int size)
 
 static cf_class _ghomo_class;
 
+/*
+ * Temporaries of ghomo_next_term(), kept in the instance so that no
+ * mpz is initialised or cleared while terms are emitted.
+ */
+typedef struct _ghomo_scratch ghomo_scratch;
+struct _ghomo_scratch {
+    mpz_t i0, i1, a, b, c, t1, t2, t3, t4;
+};
+
 typedef struct _ghomo ghomo;
 struct _ghomo {
     cf base;
     mpz_t a, b, c, d;
     gcf * x;
+    ghomo_scratch s;
 };
 
+static void ghomo_scratch_init(ghomo_scratch *s)
+{
+    mpz_inits(s->i0, s->i1, s->a, s->b, s->c,
+              s->t1, s->t2, s->t3, s->t4, NULL);
+}
+
+static void ghomo_scratch_clear(ghomo_scratch *s)
+{
+    mpz_clears(s->i0, s->i1, s->a, s->b, s->c,
+               s->t1, s->t2, s->t3, s->t4, NULL);
+}
+
 static long long ghomo_next_term(cf *g)
 {
     unsigned int limit = UINT_MAX;
-    mpz_t i0, i1, a, b, c, t1, t2, t3, t4;
     long long result = LLONG_MAX;
     number_pair p;
     ghomo * h = (ghomo*) g;
-
-    mpz_inits(i0, i1, a, b, c, t1, t2, t3, t4, NULL);
+    mpz_ptr i0 = h->s.i0, i1 = h->s.i1;
+    mpz_ptr a = h->s.a, b = h->s.b, c = h->s.c;
+    mpz_ptr t1 = h->s.t1, t2 = h->s.t2, t3 = h->s.t3, t4 = h->s.t4;
 
     while (--limit)
     {
@@ -165,7 +187,6 @@ static long long ghomo_next_term(cf *g)
         }
     }
 EXIT_FUNC:
-    mpz_clears(i0, i1, a, b, c, t1, t2, t3, t4, NULL);
     return result;
 }
 
@@ -179,6 +200,7 @@ static void ghomo_free(cf *c)
 {
     ghomo * h = (ghomo*) c;
     mpz_clears(h->a, h->b, h->c, h->d, NULL);
+    ghomo_scratch_clear(&h->s);
     cf_free(h->x);
     free(h);
 }
@@ -213,6 +235,7 @@ cf * cf_create_from_ghomo_mpz(const gcf * x,
     h->base.object_class = &_ghomo_class;
 
     mpz_inits(h->a, h->b, h->c, h->d, NULL);
+    ghomo_scratch_init(&h->s);
     mpz_set(h->a, a);
     mpz_set(h->b, b);
     mpz_set(h->c, c);
@@ -233,6 +256,7 @@ cf * cf_create_from_ghomo(const gcf * x,
     h->base.object_class = &_ghomo_class;
 
     mpz_inits(h->a, h->b, h->c, h->d, NULL);
+    ghomo_scratch_init(&h->s);
     mpz_set_ll(h->a, a);
     mpz_set_ll(h->b, b);
     mpz_set_ll(h->c, c);
@@ -316,14 +340,6 @@ gcf * gcf_create_from_pi(void)
     return &pi->base;
 }
 
-cf * cf_create_from_pi(void)
-{
-    gcf *g = gcf_create_from_pi();
-    cf * c = cf_create_from_ghomo(g, 1, 0, 0, 1);
-    cf_free(g);
-    return c;
-}
-
 /*
  * one algorithm to calculate sqrt(n)
  * let m*m is the max square less then or equal to n,
@@ -405,14 +421,6 @@ gcf * gcf_create_from_sqrt_n(unsigned long long n)
     }
 }
 
-cf * cf_create_from_sqrt_n(unsigned long long n)
-{
-    gcf * g = gcf_create_from_sqrt_n(n);
-    cf * c = cf_create_from_ghomo(g, 1, 0, 0, 1);
-    cf_free(g);
-    return c;
-}
-
 /*
  * Create a GCF which the value is n-th root of v.
  *
@@ -526,31 +534,6 @@ static inline int get_highest_bit(unsigned long long v)
 }
 #endif
 
-/* macro detect_overflow(is_overflow) */
-#if defined(__GNUC__) && defined(i386)
-#define detect_overflow(is_overflow)                         \
-{                                                            \
-    size_t eflags;                                           \
-	__asm__ (                                                \
-		"pushfl;"                                            \
-		"popl %%eax"                                         \
-      : "=a" (eflags));                                      \
-    is_overflow |= (eflags >> 11) & 1;                       \
-}
-#elif defined(__GNUC__) && defined(__x86_64__)
-#define detect_overflow(is_overflow)                         \
-{                                                            \
-    size_t rflags;                                           \
-	__asm__ (                                                \
-		"pushfq;"                                            \
-		"popq %%rax"                                         \
-      : "=a" (rflags));                                      \
-    is_overflow |= (rflags >> 11) & 1;                       \
-}
-#else
-#error detect_overflow() not implemented!
-#endif
-
 /**
  * find a: a^n <= v; (a+1)^n > v;
  * n log a <= log v, log a <= 1/n log v
@@ -570,8 +553,7 @@ static int find_power(unsigned long long v, unsigned long n,
         unsigned long m = n;
         while (m > 1)
         {
-            pow_n_md *= md;
-            detect_overflow(is_overflow);
+            is_overflow = __builtin_mul_overflow(pow_n_md, md, &pow_n_md);
             if (is_overflow || pow_n_md > v)
             {
                 break;
@@ -6,24 +6,67 @@
 #include "cf.h"
 #include "common.h"
 
+/*
+ * Temporaries of cf_digit_gen_dec_next_term(), kept in the generator
+ * so that no mpz is initialised or cleared while digits are emitted.
+ */
+typedef struct _cf_digit_gen_dec_scratch cf_digit_gen_dec_scratch;
+struct _cf_digit_gen_dec_scratch {
+    mpz_t i0, i1, r0, r1, a, b, t1, t2, t3, t4;
+};
+
 typedef struct _cf_digit_gen_dec cf_digit_gen_dec;
 struct _cf_digit_gen_dec {
     cf_digit_gen base;
     mpz_t a, b, c, d;
     int sgn;
     cf * x;
+    cf_digit_gen_dec_scratch s;
 };
 
+/*
+ * Take the next term of x into (ax + b) / (cx + d).
+ */
+static
+void cf_digit_gen_dec_ingest(cf_digit_gen_dec *g)
+{
+    mpz_ptr a = g->s.a, b = g->s.b, t1 = g->s.t1, t2 = g->s.t2;
+    long long p;
+
+    if (cf_is_finished(g->x))
+    {
+        mpz_set(g->b, g->a);
+        mpz_set(g->d, g->c);
+    }
+    else
+    {
+        p = cf_next_term(g->x);
+        mpz_set_ll(t1, p);
+
+        mpz_set(a, g->a);
+        mpz_set(b, g->c);
+
+        mpz_mul(t2, a, t1);
+        mpz_add(g->a, t2, g->b);
+
+        mpz_set(g->b, a);
+
+        mpz_mul(t2, b, t1);
+        mpz_add(g->c, t2, g->d);
+        mpz_set(g->d, b);
+    }
+}
+
 static
 int cf_digit_gen_dec_next_term(cf_digit_gen *gen)
 {
     unsigned int limit = UINT_MAX;
-    mpz_t i0, i1, r0, r1, a, b, c, t1, t2, t3, t4;
-    long long p;
     int result = INT_MAX;
     cf_digit_gen_dec * g = (cf_digit_gen_dec*)gen;
+    mpz_ptr i0 = g->s.i0, i1 = g->s.i1, r0 = g->s.r0, r1 = g->s.r1;
+    mpz_ptr a = g->s.a, b = g->s.b;
+    mpz_ptr t1 = g->s.t1, t2 = g->s.t2, t3 = g->s.t3, t4 = g->s.t4;
 
-    mpz_inits(i0, i1, r0, r1, a, b, c, t1, t2, t3, t4, NULL);
     while (--limit)
     {
         if (mpz_sgn(g->c) != 0)
@@ -97,32 +140,104 @@ int cf_digit_gen_dec_next_term(cf_digit_gen *gen)
             goto EXIT_FUNC;
         }
 
-        if (cf_is_finished(g->x))
+        cf_digit_gen_dec_ingest(g);
+    }
+EXIT_FUNC:
+    return result;
+}
+
+/*
+ * Digits in a chunk of cf_digit_gen_next_digits(): 10^k must fit in an
+ * unsigned long.
+ */
+#if ULONG_MAX >= 10000000000000000000ul
+#define CF_DIGIT_CHUNK 18
+#else
+#define CF_DIGIT_CHUNK 9
+#endif
+
+/*
+ * Retrieve the next k digits (k <= CF_DIGIT_CHUNK) at once, as the
+ * integer part of 10^(k-1) (ax + b) / (cx + d).  Returns 0 if the
+ * generator finishes before, with no digit.
+ */
+static
+int cf_digit_gen_dec_next_chunk(cf_digit_gen_dec *g, int k,
+                                unsigned long *chunk)
+{
+    unsigned long scale = 1u;
+    mpz_ptr i0 = g->s.i0, i1 = g->s.i1, t1 = g->s.t1, t2 = g->s.t2;
+    int i;
+
+    for (i = 1; i < k; ++i)
+    {
+        scale *= 10u;
+    }
+
+    for (;;)
+    {
+        if (cf_is_finished(&g->base))
+            return 0;
+        if (mpz_sgn(g->c) != 0 && mpz_sgn(g->d) != 0)
         {
-            mpz_set(g->b, g->a);
-            mpz_set(g->d, g->c);
+            mpz_mul_ui(t1, g->a, scale);
+            mpz_mul_ui(t2, g->b, scale);
+            mpz_fdiv_q(i1, t1, g->c);
+            mpz_fdiv_q(i0, t2, g->d);
+            if (mpz_cmp(i1, i0) == 0)
+                break;
         }
-        else
-        {
-            p = cf_next_term(g->x);
-            mpz_set_ll(t1, p);
+        cf_digit_gen_dec_ingest(g);
+    }
 
-            mpz_set(a, g->a);
-            mpz_set(b, g->c);
+    /* (a, b) <- 10 (10^(k-1) (a, b) - chunk (c, d)) */
+    *chunk = mpz_get_ui(i1);
+    mpz_submul(t1, i1, g->c);
+    mpz_submul(t2, i1, g->d);
+    mpz_mul_ui(g->a, t1, 10u);
+    mpz_mul_ui(g->b, t2, 10u);
+    return 1;
+}
 
-            mpz_mul(t2, a, t1);
-            mpz_add(g->a, t2, g->b);
+size_t cf_digit_gen_next_digits(cf_digit_gen *gen, char *buf, size_t n)
+{
+    cf_digit_gen_dec * g = (cf_digit_gen_dec*)gen;
+    size_t count = 0;
 
-            mpz_set(g->b, a);
+    while (count < n && !cf_is_finished(gen))
+    {
+        int k = n - count < CF_DIGIT_CHUNK ? (int)(n - count) : CF_DIGIT_CHUNK;
+        unsigned long chunk;
+        int i;
 
-            mpz_mul(t2, b, t1);
-            mpz_add(g->c, t2, g->d);
-            mpz_set(g->d, b);
+        if (!cf_digit_gen_dec_next_chunk(g, k, &chunk))
+            break;
+        for (i = k - 1; i >= 0; --i)
+        {
+            buf[count + i] = (char)('0' + chunk % 10u);
+            chunk /= 10u;
+        }
+        count += k;
+        if (cf_is_finished(gen))
+        {
+            /* the value ends inside the chunk */
+            while (count > 0 && buf[count - 1] == '0')
+                --count;
         }
     }
-EXIT_FUNC:
-    mpz_clears(i0, i1, r0, r1, a, b, c, t1, t2, t3, t4, NULL);
-    return result;
+    return count;
+}
+
+size_t cf_digit_gen_peek_digits(const cf_digit_gen *gen, char *buf, size_t n)
+{
+    cf_digit_gen * copy = cf_copy(gen);
+    size_t count;
+
+    if (!copy)
+        return 0;
+    count = cf_digit_gen_next_digits(copy, buf, n);
+    cf_free(copy);
+    return count;
 }
 
 static
@@ -139,14 +254,30 @@ void cf_digit_gen_dec_free(cf_digit_gen *gen)
     cf_digit_gen_dec * g = (cf_digit_gen_dec*)gen;
     cf_free(g->x);
     mpz_clears(g->a, g->b, g->c, g->d, NULL);
+    mpz_clears(g->s.i0, g->s.i1, g->s.r0, g->s.r1, g->s.a, g->s.b,
+               g->s.t1, g->s.t2, g->s.t3, g->s.t4, NULL);
     free(g);
 }
 
+/*
+ * The copy goes on from the state of gen, and shares its input.
+ */
 static
 cf_digit_gen * cf_digit_gen_dec_copy(const cf_digit_gen * gen)
 {
-    const cf_digit_gen_dec * g = (const cf_digit_gen_dec *)gen;
-    return cf_digit_gen_create_dec(g->x);
+    cf_digit_gen_dec * g = (cf_digit_gen_dec *)gen;
+    cf_digit_gen_dec * copy;
+
+    cf_tape_share(&g->x);
+    copy = (cf_digit_gen_dec*) cf_digit_gen_create_dec(g->x);
+    if (!copy)
+        return NULL;
+    mpz_set(copy->a, g->a);
+    mpz_set(copy->b, g->b);
+    mpz_set(copy->c, g->c);
+    mpz_set(copy->d, g->d);
+    copy->sgn = g->sgn;
+    return &copy->base;
 }
 
 static
@@ -176,94 +307,80 @@ cf_digit_gen * cf_digit_gen_create_dec(const cf * x)
     mpz_init_set_ui(g->b, 0u);
     mpz_init_set_ui(g->c, 0u);
     mpz_init_set_ui(g->d, 1u);
+    mpz_inits(g->s.i0, g->s.i1, g->s.r0, g->s.r1, g->s.a, g->s.b,
+              g->s.t1, g->s.t2, g->s.t3, g->s.t4, NULL);
     g->x = cf_copy(x);
     g->sgn = 0;
     g->base.object_class = &_cf_digit_gen_dec_class;
     return &g->base;
 }
 
-char * cf_convert_to_string_float(const cf *c, int max_digits)
+void cf_digit_gen_write_float(cf_writer *w, const cf *c, int max_digits)
 {
     cf_digit_gen * gen;
-    char buf[64], *p, *result;
-    int size, count, digit, got_dot = 0;
-    int realloced = 0;
-
-    p = buf;
-    size = sizeof(buf);
-    count = 0;
-    realloced = 0;
+    char buf[CF_WRITE_BLOCK];
+    int count = 0;
 
     gen = cf_digit_gen_create_dec(c);
-    while (max_digits > 0 && !cf_is_finished(gen))
+    if (!gen)
     {
-        int chars, sgn = 0;
-        digit = cf_next_term(gen);
-        if (count == 0 && digit == 0 && ((cf_digit_gen_dec*)gen)->sgn)
+        w->error = 1;
+        return;
+    }
+    if (max_digits > 0 && !cf_is_finished(gen))
+    {
+        /* the integer part, which takes max_digits for its digits but one */
+        int digit = cf_next_term(gen);
+        if (digit == 0 && ((cf_digit_gen_dec*)gen)->sgn)
         {
-            chars = sprintf(p, "-0");
-            sgn = 1;
+            count = sprintf(buf, "-0");
+            max_digits += 1;
         }
         else
         {
-            chars = snprintf(p + count, size - count, "%d", digit);
-            sgn = digit < 0;
-        }
-        if (!count && !cf_is_finished(gen))
-        {
-            snprintf(p + count + chars, size - count - chars, ".");
-            ++count;
-            got_dot = 1;
-            max_digits++;
-        }
-        count += chars;
-        if (got_dot)
-        {
-            max_digits -= chars - sgn;
+            count = sprintf(buf, "%d", digit);
+            max_digits += digit < 0;
         }
-        // reallocate new buffer to contain the too long string.
-        if (count > size - 5)
+        max_digits -= count - 1;
+        cf_writer_put(w, buf, count);
+    }
+
+    if (count && !cf_is_finished(gen))
+    {
+        /* the fractional part, in chunks of digits */
+        cf_writer_puts(w, ".");
+        while (max_digits > 0 && !cf_is_finished(gen) && !w->error)
         {
-            int new_size = size << 1;
-            char * new_buf = (char*)malloc(new_size);
-            if (!new_buf)
-            {
-                // failed.
-                break;
-            }
-            memcpy(new_buf, p, count);
-            if (realloced)
-            {
-                free(p);
-            }
-            p = new_buf;
-            size = new_size;
-            realloced = 1;
+            size_t n = max_digits < CF_WRITE_BLOCK ? max_digits : CF_WRITE_BLOCK;
+            n = cf_digit_gen_next_digits(gen, buf, n);
+            cf_writer_put(w, buf, n);
+            max_digits -= n;
         }
     }
 
     if (count)
     {
         if (!cf_is_finished(gen))
-        {
-            strcpy(p+count, "...");
-        }
-        else
-        {
-            p[count] = '\0';
-        }
+            cf_writer_puts(w, "...");
     }
     else
     {
-        strcpy(p, "NAN");
+        cf_writer_puts(w, "NAN");
     }
+    cf_free(gen);
+}
+
+char * cf_convert_to_string_float(const cf *c, int max_digits)
+{
+    cf_string str = {NULL, 0, 0};
+    cf_writer w;
 
-    result = strdup(p);
-    if (realloced)
+    cf_writer_init(&w, cf_string_sink, &str);
+    cf_digit_gen_write_float(&w, c, max_digits);
+    if (cf_writer_flush(&w) != 0)
     {
-        free(p);
+        free(str.s);
+        return NULL;
     }
-    cf_free(gen);
-
-    return result;
+    return str.s;
 }
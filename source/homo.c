@@ -3,20 +3,38 @@
 #include <limits.h>
 
 #include "cf.h"
+#include "common.h"
+#include "coefs.h"
 
 static cf_class _homographic_class;
 
+/*
+ * (ax + b) / (cx + d), with a, b, c, d kept in k[0..3]. The coefficients
+ * start as long long and are promoted on overflow by coefs.
+ */
+enum { HA, HB, HC, HD };
+
+static const coefs_pair _homo_ingest[2] = {{HA, HB}, {HC, HD}};
+static const coefs_pair _homo_emit[2] = {{HC, HA}, {HD, HB}};
+
 typedef struct _homographic homographic;
 struct _homographic {
     cf base;
-    long long a, b, c, d;
+    coefs k;
     cf * x;
+    cf_term_block xb;
 };
 
+static int homographic_done(const homographic *h)
+{
+    return coefs_is_zero(&h->k, HC) && coefs_is_zero(&h->k, HD);
+}
+
 static long long homographic_next_term(cf *c)
 {
     long long i1, i0;
     long long p;
+    int e1 = 1, e0 = 1;
 
     unsigned limit = 10000;
 
@@ -24,70 +42,93 @@ static long long homographic_next_term(cf *c)
 
     while (--limit)
     {
-        i1 = h->c ? h->a / h->c : LLONG_MAX;
-        i0 = h->d ? h->b / h->d : LLONG_MAX;
+        i1 = !coefs_is_zero(&h->k, HC) ? coefs_quot(&h->k, HA, HC, &e1)
+                                       : LLONG_MAX;
+        i0 = !coefs_is_zero(&h->k, HD) ? coefs_quot(&h->k, HB, HD, &e0)
+                                       : LLONG_MAX;
 
-        if (i1 == i0)
+        if (i1 == i0 && e1 == e0)
         {
-            long long a = h->a, b = h->b;
+            if (homographic_done(h))
+                return LLONG_MAX;
 
-            if (h->c == 0ll && h->d == 0ll)
+            if (!e1 && !e0)
+            {
+                /* the term does not fit in long long */
+                coefs_zero(&h->k, HC);
+                coefs_zero(&h->k, HD);
                 return LLONG_MAX;
+            }
 
-            if (i1 < 0 && !cf_is_finished(h->x))
+            if (i1 < 0 && !cf_term_block_is_finished(&h->xb, h->x))
                 --i1;
 
-            h->a = h->c;
-            h->b = h->d;
-
-            h->c = a - i1 * h->c;
-            h->d = b - i1 * h->d;
+            coefs_step_sub(&h->k, _homo_emit, 2, i1);
+            if (h->k.tier != COEFS_TIER_LL)
+                coefs_demote(&h->k);
             return i1;
         }
 
-        p = cf_next_term(h->x);
-        if (p == LLONG_MAX && cf_is_finished(h->x))
+        p = cf_term_block_next(&h->xb, h->x);
+        if (p == LLONG_MAX && cf_term_block_is_finished(&h->xb, h->x))
         {
-            h->b = h->a;
-            h->d = h->c;
+            coefs_set(&h->k, HB, HA);
+            coefs_set(&h->k, HD, HC);
         }
         else
         {
-            long long a = h->a, c = h->c;
-
-            h->a = a * p + h->b;
-            h->b = a;
-            h->c = c * p + h->d;
-            h->d = c;
+            coefs_step(&h->k, _homo_ingest, 2, p);
         }
     }
     return LLONG_MAX;
 }
 
+static size_t homographic_next_terms(cf *c, long long *buf, size_t n)
+{
+    size_t i;
+    homographic * h = (homographic*) c;
+
+    for (i = 0; i < n && !homographic_done(h); ++i)
+    {
+        buf[i] = homographic_next_term(c);
+    }
+    return i;
+}
+
 static int homographic_is_finished(const cf * c)
 {
     homographic * h = (homographic*) c;
-    return h->c == 0ll && h->d == 0ll;
+    return homographic_done(h);
 }
 
 static void homographic_free(cf *c)
 {
     homographic * h = (homographic*) c;
     cf_free(h->x);
+    coefs_clear(&h->k);
     free(h);
 }
 
 static cf * homographic_copy(const cf * c)
 {
     homographic * h = (homographic*) c;
-    return cf_create_from_homographic(h->x, h->a, h->b, h->c, h->d);
+    homographic * copy;
+
+    cf_tape_share(&h->x);
+    copy = (homographic*) cf_create_from_homographic(h->x, 0, 0, 0, 0);
+    if (!copy)
+        return NULL;
+    coefs_init_copy(&copy->k, &h->k);
+    copy->xb = h->xb;
+    return &copy->base;
 }
 
 static cf_class _homographic_class = {
     homographic_next_term,
     homographic_is_finished,
     homographic_free,
-    homographic_copy
+    homographic_copy,
+    homographic_next_terms
 };
 
 cf * cf_create_from_homographic(const cf * x,
@@ -95,16 +136,19 @@ cf * cf_create_from_homographic(const cf * x,
                                long long c, long long d)
 {
     homographic * h = (homographic*)malloc(sizeof(homographic));
+    long long v[4];
 
     if (!h)
         return NULL;
 
     h->base.object_class = &_homographic_class;
 
-    h->a = a;
-    h->b = b;
-    h->c = c;
-    h->d = d;
+    v[HA] = a;
+    v[HB] = b;
+    v[HC] = c;
+    v[HD] = d;
+    coefs_init(&h->k, 4, v, 0);
     h->x = cf_copy(x);
+    cf_term_block_init(&h->xb);
     return &h->base;
 }
@@ -0,0 +1,391 @@
+/**
+ * continued fraction of a rational in GMP integers.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "common.h"
+#include "cf_mpz.h"
+
+/* reduce by plain divisions when fewer bits than this are to be removed */
+#define MPZRAT_BASE_BITS   256
+
+/* extra low bits kept below the leading part of a recursive step */
+#define MPZRAT_GUARD_BITS  64
+
+/* terms of a top level step of plain divisions */
+#define MPZRAT_SMALL_TERMS 64
+
+/* growing list of partial quotients */
+typedef struct _mpzrat_quots mpzrat_quots;
+struct _mpzrat_quots {
+    long long * q;
+    size_t n, cap;
+};
+
+static int mpzrat_quots_push(mpzrat_quots *l, long long q)
+{
+    if (l->n == l->cap)
+    {
+        size_t cap = l->cap ? l->cap * 2 : 64;
+        long long * p = (long long*)realloc(l->q, cap * sizeof(long long));
+        if (!p)
+            return -1;
+        l->q = p;
+        l->cap = cap;
+    }
+    l->q[l->n++] = q;
+    return 0;
+}
+
+/*
+ * The matrices of steps are m = [m[0] m[1]; m[2] m[3]], products of
+ * [q 1; 1 0] for the quotients q, so that (a, b) = m (a', b') where
+ * (a', b') are the remainders after the steps.
+ */
+static void mpzrat_matrix_init(mpz_t *m)
+{
+    mpz_init_set_ui(m[0], 1u);
+    mpz_init_set_ui(m[1], 0u);
+    mpz_init_set_ui(m[2], 0u);
+    mpz_init_set_ui(m[3], 1u);
+}
+
+static void mpzrat_matrix_clear(mpz_t *m)
+{
+    mpz_clears(m[0], m[1], m[2], m[3], NULL);
+}
+
+/*
+ * m = m * m1
+ */
+static void mpzrat_matrix_mul(mpz_t *m, mpz_t *m1, mpz_t t)
+{
+    /* first row */
+    mpz_mul(t, m[0], m1[1]);
+    mpz_addmul(t, m[1], m1[3]);
+    mpz_mul(m[0], m[0], m1[0]);
+    mpz_addmul(m[0], m[1], m1[2]);
+    mpz_swap(m[1], t);
+    /* second row */
+    mpz_mul(t, m[2], m1[1]);
+    mpz_addmul(t, m[3], m1[3]);
+    mpz_mul(m[2], m[2], m1[0]);
+    mpz_addmul(m[2], m[3], m1[2]);
+    mpz_swap(m[3], t);
+}
+
+/*
+ * One step of Euclid: (a, b) <- (b, a - q b) and m <- m [q 1; 1 0].
+ *
+ * Returns 0, or -1 without any change if q does not fit in long long
+ * or if it cannot be recorded.
+ */
+static int mpzrat_step(mpz_t a, mpz_t b, mpz_t *m, mpzrat_quots *l, mpz_t q)
+{
+    mpz_fdiv_qr(q, a, a, b);
+    if (mpz_sizeinbase(q, 2) > 63 || mpzrat_quots_push(l, mpz_get_ll(q)))
+    {
+        mpz_addmul(a, b, q);
+        return -1;
+    }
+    mpz_swap(a, b);
+    if (m)
+    {
+        mpz_addmul(m[1], m[0], q);
+        mpz_swap(m[0], m[1]);
+        mpz_addmul(m[3], m[2], q);
+        mpz_swap(m[2], m[3]);
+    }
+    return 0;
+}
+
+/*
+ * Undo the last step of quotient q: (a, b) <- (q a + b, a) and
+ * m <- m [0 1; 1 -q].
+ */
+static void mpzrat_unstep(mpz_t a, mpz_t b, mpz_t *m, long long q, mpz_t t)
+{
+    mpz_set_ll(t, q);
+    mpz_addmul(b, a, t);
+    mpz_swap(a, b);
+    mpz_submul(m[0], m[1], t);
+    mpz_swap(m[0], m[1]);
+    mpz_submul(m[2], m[3], t);
+    mpz_swap(m[2], m[3]);
+}
+
+/*
+ * Reduce (a, b), a > b >= 0, by steps of Euclid until a has no more than
+ * s bits or b is 0.  The quotients are appended to l, and if m is not
+ * NULL it is set to the product matrix of the steps.
+ *
+ * While many bits are to be removed, the quotients are worked out from
+ * the leading bits of a and b by a recursive call, and then applied to
+ * the full numbers at once.  The quotients of the leading bits are only
+ * a guess: they are the true quotients of a / b exactly if the
+ * remainders come out as a' > b' > 0 (or b' = 0 after a last quotient
+ * other than 1), and the last ones are taken back until they do.
+ */
+static void mpzrat_reduce(mpz_t a, mpz_t b, size_t s, mpz_t *m,
+                          mpzrat_quots *l)
+{
+    mpz_t a1, b1, t, m1[4];
+
+    mpz_inits(a1, b1, t, NULL);
+    mpzrat_matrix_init(m1);
+    if (m)
+    {
+        mpz_set_ui(m[0], 1u);
+        mpz_set_ui(m[1], 0u);
+        mpz_set_ui(m[2], 0u);
+        mpz_set_ui(m[3], 1u);
+    }
+
+    while (mpz_sgn(b) != 0)
+    {
+        size_t n = mpz_sizeinbase(a, 2);
+        size_t h, p, k0, k;
+
+        if (n <= s)
+            break;
+
+        if (n - s <= MPZRAT_BASE_BITS || s <= 2 * MPZRAT_GUARD_BITS)
+        {
+            if (mpzrat_step(a, b, m, l, t) != 0)
+                break;
+            continue;
+        }
+
+        /* remove about h bits by the leading 2h + guard bits */
+        h = (n - s) / 2;
+        p = n - 2 * h - MPZRAT_GUARD_BITS;
+        mpz_tdiv_q_2exp(a1, a, p);
+        mpz_tdiv_q_2exp(b1, b, p);
+
+        k0 = l->n;
+        mpzrat_reduce(a1, b1, mpz_sizeinbase(a1, 2) - h, m1, l);
+        k = l->n - k0;
+
+        if (k > 0)
+        {
+            /* (a1, b1) = m1^-1 (a, b), det(m1) = (-1)^k */
+            mpz_mul(a1, m1[3], a);
+            mpz_submul(a1, m1[1], b);
+            mpz_mul(b1, m1[0], b);
+            mpz_submul(b1, m1[2], a);
+            if (k & 1)
+            {
+                mpz_neg(a1, a1);
+                mpz_neg(b1, b1);
+            }
+        }
+        while (k > 0 &&
+               !(mpz_cmp(a1, b1) > 0 &&
+                 (mpz_sgn(b1) > 0 ||
+                  (mpz_sgn(b1) == 0 && l->q[l->n - 1] > 1))))
+        {
+            /* take back the last quotient */
+            mpzrat_unstep(a1, b1, m1, l->q[--l->n], t);
+            --k;
+        }
+
+        if (k == 0)
+        {
+            if (mpzrat_step(a, b, m, l, t) != 0)
+                break;
+            continue;
+        }
+
+        mpz_swap(a, a1);
+        mpz_swap(b, b1);
+        if (m)
+            mpzrat_matrix_mul(m, m1, t);
+    }
+
+    mpzrat_matrix_clear(m1);
+    mpz_clears(a1, b1, t, NULL);
+}
+
+static cf_class _mpzrat_class;
+
+typedef struct _mpzrat mpzrat;
+struct _mpzrat {
+    cf base;
+    mpz_t a, b;         /* the rest of the value is a / b */
+    mpzrat_quots terms; /* terms worked out but not retrieved */
+    size_t pos;
+    int is_finished;
+};
+
+/*
+ * Work out more terms into the list, after all terms are retrieved.
+ */
+static void mpzrat_fill(mpzrat *r)
+{
+    size_t i;
+    mpz_t t;
+
+    r->terms.n = 0;
+    r->pos = 0;
+    if (mpz_sgn(r->b) == 0)
+    {
+        r->is_finished = 1;
+        return;
+    }
+
+    mpz_init(t);
+    if (mpz_sizeinbase(r->a, 2) > 4 * MPZRAT_BASE_BITS)
+    {
+        /* halve the numbers */
+        mpzrat_reduce(r->a, r->b, mpz_sizeinbase(r->a, 2) / 2, NULL,
+                      &r->terms);
+    }
+    for (i = 0; r->terms.n == 0 ||
+                (i < MPZRAT_SMALL_TERMS &&
+                 mpz_sizeinbase(r->a, 2) <= 4 * MPZRAT_BASE_BITS); ++i)
+    {
+        if (mpz_sgn(r->b) == 0)
+            break;
+        if (mpzrat_step(r->a, r->b, NULL, &r->terms, t) != 0)
+        {
+            /* the term is too large */
+            if (mpzrat_quots_push(&r->terms, LLONG_MAX) == 0)
+                mpz_set_ui(r->b, 0u);
+            break;
+        }
+    }
+    mpz_clear(t);
+
+    if (r->terms.n == 0)
+        r->is_finished = 1;
+}
+
+static long long mpzrat_next_term(cf *c)
+{
+    mpzrat * r = (mpzrat*) c;
+
+    if (r->pos == r->terms.n)
+        mpzrat_fill(r);
+    if (r->is_finished)
+        return LLONG_MAX;
+    return r->terms.q[r->pos++];
+}
+
+static int mpzrat_is_finished(const cf * c)
+{
+    mpzrat * r = (mpzrat*) c;
+    return r->is_finished || (r->pos == r->terms.n && mpz_sgn(r->b) == 0);
+}
+
+static size_t mpzrat_next_terms(cf *c, long long *buf, size_t n)
+{
+    mpzrat * r = (mpzrat*) c;
+    size_t i = 0;
+
+    while (i < n && !mpzrat_is_finished(c))
+    {
+        size_t len;
+
+        if (r->pos == r->terms.n)
+        {
+            mpzrat_fill(r);
+            if (r->is_finished)
+                break;
+        }
+        len = r->terms.n - r->pos;
+        if (len > n - i)
+            len = n - i;
+        memcpy(buf + i, r->terms.q + r->pos, len * sizeof(long long));
+        r->pos += len;
+        i += len;
+    }
+    return i;
+}
+
+static void mpzrat_free(cf *c)
+{
+    mpzrat * r = (mpzrat*) c;
+    mpz_clears(r->a, r->b, NULL);
+    free(r->terms.q);
+    free(r);
+}
+
+static mpzrat * mpzrat_alloc(void)
+{
+    mpzrat * r = (mpzrat*)malloc(sizeof(mpzrat));
+
+    if (!r)
+        return NULL;
+
+    r->base.object_class = &_mpzrat_class;
+    mpz_inits(r->a, r->b, NULL);
+    r->terms.q = NULL;
+    r->terms.n = r->terms.cap = 0;
+    r->pos = 0;
+    r->is_finished = 0;
+    return r;
+}
+
+static cf * mpzrat_copy(const cf * c)
+{
+    mpzrat * r = (mpzrat*) c;
+    mpzrat * copy = mpzrat_alloc();
+    size_t i;
+
+    if (!copy)
+        return NULL;
+
+    mpz_set(copy->a, r->a);
+    mpz_set(copy->b, r->b);
+    copy->is_finished = r->is_finished;
+    for (i = r->pos; i < r->terms.n; ++i)
+    {
+        if (mpzrat_quots_push(&copy->terms, r->terms.q[i]) != 0)
+        {
+            mpzrat_free(&copy->base);
+            return NULL;
+        }
+    }
+    return &copy->base;
+}
+
+static cf_class _mpzrat_class = {
+    mpzrat_next_term,
+    mpzrat_is_finished,
+    mpzrat_free,
+    mpzrat_copy,
+    mpzrat_next_terms
+};
+
+cf * cf_create_from_mpz_fraction(mpz_srcptr n, mpz_srcptr d)
+{
+    mpzrat * r = mpzrat_alloc();
+    mpz_t q;
+
+    if (!r)
+        return NULL;
+
+    /* the first term is floor(n / d), and the rest is d / (n mod d) */
+    mpz_init(q);
+    mpz_set(r->a, d);
+    mpz_fdiv_qr(q, r->b, n, d);
+    if (mpz_sgn(d) < 0)
+    {
+        mpz_neg(r->a, r->a);
+        mpz_neg(r->b, r->b);
+    }
+
+    if (mpz_sizeinbase(q, 2) > 63 ||
+        mpzrat_quots_push(&r->terms, mpz_get_ll(q)) != 0)
+    {
+        r->terms.n = 0;
+        mpzrat_quots_push(&r->terms, LLONG_MAX);
+        mpz_set_ui(r->b, 0u);
+    }
+    mpz_clear(q);
+    return &r->base;
+}
@@ -1,17 +1,49 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "cf.h"
 
+/*
+ * Array of terms shared by a CF and its copies, released with the last
+ * of them.
+ */
+typedef struct _numbers_buf numbers_buf;
+struct _numbers_buf {
+    int refs;
+    const long long * arr;
+    size_t size;
+    void (*release)(numbers_buf *buf);
+};
+
+static void numbers_release_none(numbers_buf *buf)
+{
+    (void)buf;
+}
+
+static void numbers_release_free(numbers_buf *buf)
+{
+    free((void*)buf->arr);
+}
+
+static void numbers_release_unmap(numbers_buf *buf)
+{
+    munmap((void*)buf->arr, buf->size * sizeof(long long));
+}
+
 static cf_class _numbers_class;
 
 typedef struct _numbers numbers;
 struct _numbers {
     cf base;
-    long long *arr;
-    unsigned int size;
-    unsigned int idx;
+    numbers_buf * buf;
+    const long long * arr;
+    size_t size;
+    size_t idx;
 };
 
 static long long numbers_next_term(cf *c)
@@ -20,6 +52,18 @@ static long long numbers_next_term(cf *c)
     return n->idx < n->size ? n->arr[n->idx++] : LLONG_MAX;
 }
 
+static size_t numbers_next_terms(cf *c, long long *buf, size_t n)
+{
+    numbers * num = (numbers*)c;
+    size_t left = num->size - num->idx;
+
+    if (n > left)
+        n = left;
+    memcpy(buf, num->arr + num->idx, n * sizeof(long long));
+    num->idx += n;
+    return n;
+}
+
 static int numbers_is_finished(const cf * c)
 {
     return ((numbers*)c)->idx >= ((numbers*)c)->size;
@@ -27,40 +71,126 @@ static int numbers_is_finished(const cf * c)
 
 static void numbers_free(cf *c)
 {
-    free(((numbers*)c)->arr);
+    numbers_buf * buf = ((numbers*)c)->buf;
+
+    if (__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        buf->release(buf);
+        free(buf);
+    }
     free(c);
 }
 
+/*
+ * The copy shares the array, only the position is its own.
+ */
 static cf * numbers_copy(const cf * c)
 {
-    numbers * n = (numbers*)c;
-    return cf_create_from_terms(n->arr + n->idx, n->size - n->idx);
+    numbers * copy = (numbers*)malloc(sizeof(numbers));
+
+    if (!copy)
+        return NULL;
+    *copy = *(const numbers*)c;
+    __atomic_add_fetch(&copy->buf->refs, 1, __ATOMIC_RELAXED);
+    return &copy->base;
 }
 
 static cf_class _numbers_class = {
     numbers_next_term,
     numbers_is_finished,
     numbers_free,
-    numbers_copy
+    numbers_copy,
+    numbers_next_terms
 };
 
+static cf * numbers_create(const long long * arr, size_t size,
+                           void (*release)(numbers_buf *buf))
+{
+    numbers_buf * buf = (numbers_buf*)malloc(sizeof(numbers_buf));
+    numbers * n = (numbers*)malloc(sizeof(numbers));
+
+    if (!buf || !n)
+    {
+        free(buf);
+        free(n);
+        return NULL;
+    }
+    buf->refs = 1;
+    buf->arr = arr;
+    buf->size = size;
+    buf->release = release;
+    n->base.object_class = &_numbers_class;
+    n->buf = buf;
+    n->arr = arr;
+    n->size = size;
+    n->idx = 0;
+    return &n->base;
+}
+
 cf * cf_create_from_terms(const long long * arr, unsigned int size)
 {
-    numbers * n;
+    long long * copy;
+    cf * c;
 
     if (!size || !arr)
         return NULL;
 
-    n = (numbers*)malloc(sizeof(numbers));
-    if (!n)
+    copy = (long long*)malloc(size * sizeof(long long));
+    if (!copy)
         return NULL;
+    memcpy(copy, arr, size * sizeof(long long));
+    c = numbers_create(copy, size, numbers_release_free);
+    if (!c)
+        free(copy);
+    return c;
+}
 
-    n->arr = (long long*)malloc(size * sizeof(long long));
-    memcpy(n->arr, arr, size * sizeof(long long));
-    n->idx = 0;
-    n->size = size;
-    n->base.object_class = &_numbers_class;
-    return &n->base;
+cf * cf_create_from_terms_borrowed(const long long * arr, size_t size)
+{
+    if (!size || !arr)
+        return NULL;
+    return numbers_create(arr, size, numbers_release_none);
+}
+
+cf * cf_create_from_terms_owned(long long * arr, size_t size)
+{
+    cf * c;
+
+    if (!size || !arr)
+        return NULL;
+    c = numbers_create(arr, size, numbers_release_free);
+    if (!c)
+        free(arr);
+    return c;
+}
+
+cf * cf_create_from_terms_file(const char * path)
+{
+    struct stat st;
+    void * arr;
+    size_t size;
+    int fd;
+    cf * c;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(long long) ||
+        st.st_size % sizeof(long long) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    size = (size_t)st.st_size / sizeof(long long);
+    arr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (arr == MAP_FAILED)
+        return NULL;
+
+    c = numbers_create((const long long*)arr, size, numbers_release_unmap);
+    if (!c)
+        munmap(arr, (size_t)st.st_size);
+    return c;
 }
 
 #include <stdarg.h>
@@ -88,8 +218,7 @@ cf * cf_create_from_terms_i(unsigned int number_of_int, ...)
     }
     va_end(ap);
 
-    c = cf_create_from_terms(arr, number_of_int);
-    free(arr);
+    c = cf_create_from_terms_owned(arr, number_of_int);
 
     return c;
 }
@@ -118,8 +247,7 @@ cf * cf_create_from_terms_ll(unsigned int number_of_longlong, ...)
     }
     va_end(ap);
 
-    c = cf_create_from_terms(arr, number_of_longlong);
-    free(arr);
+    c = cf_create_from_terms_owned(arr, number_of_longlong);
 
     return c;
 }
@@ -0,0 +1,276 @@
+/**
+ * products of the matrices of terms, and convergents at an index.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "cf.h"
+#include "common.h"
+#include "cf_mpz.h"
+
+/* terms multiplied one by one at the leaves of the product tree */
+#define PRODUCT_LEAF_TERMS 16
+
+/* terms below which a thread is not worth starting */
+#define PRODUCT_THREAD_TERMS 4096
+
+/* terms read at first by cf_convergent_at(), doubled as they come */
+#define PRODUCT_READ_TERMS 4096
+
+/*
+ * (r[0], r[1]) = (r[0], r[1]) * m1, a row of a product.
+ */
+static void product_row_mul(mpz_t *r, mpz_t *m1, mpz_t t)
+{
+    mpz_mul(t, r[0], m1[1]);
+    mpz_addmul(t, r[1], m1[3]);
+    mpz_mul(r[0], r[0], m1[0]);
+    mpz_addmul(r[0], r[1], m1[2]);
+    mpz_swap(r[1], t);
+}
+
+void cf_matrix_mul(mpz_t *m, mpz_t *m1, mpz_t t)
+{
+    product_row_mul(m, m1, t);
+    product_row_mul(m + 2, m1, t);
+}
+
+/*
+ * The numbers multiplied at a level of the tree are of the same size,
+ * which fast multiplications of GMP like.
+ */
+void cf_matrix_product(const long long *t, size_t n, mpz_t *m, mpz_t tmp)
+{
+    if (n <= PRODUCT_LEAF_TERMS)
+    {
+        size_t i;
+
+        mpz_set_ui(m[0], 1u);
+        mpz_set_ui(m[1], 0u);
+        mpz_set_ui(m[2], 0u);
+        mpz_set_ui(m[3], 1u);
+        for (i = 0; i < n; ++i)
+        {
+            /* (m[0], m[1]) <- (m[0] t + m[1], m[0]), and the same below */
+            mpz_set_ll(tmp, t[i]);
+            mpz_swap(m[0], m[1]);
+            mpz_addmul(m[0], m[1], tmp);
+            mpz_swap(m[2], m[3]);
+            mpz_addmul(m[2], m[3], tmp);
+        }
+    }
+    else
+    {
+        mpz_t r[4];
+
+        mpz_inits(r[0], r[1], r[2], r[3], NULL);
+        cf_matrix_product(t, n / 2, m, tmp);
+        cf_matrix_product(t + n / 2, n - n / 2, r, tmp);
+        cf_matrix_mul(m, r, tmp);
+        mpz_clears(r[0], r[1], r[2], r[3], NULL);
+    }
+}
+
+/*
+ * The terms are cut in parts, one for each thread, and the products of
+ * the parts are multiplied in pairs, level by level.  Both rows of a
+ * product of a pair are worked out at once, so that the last and largest
+ * products of the tree run on two threads too.
+ */
+typedef struct _product_part product_part;
+struct _product_part {
+    const long long * t;
+    size_t n;
+    mpz_t m[4];
+    mpz_t tmp[2];
+};
+
+typedef struct _product_task product_task;
+struct _product_task {
+    product_part * part;
+    product_part * right;   /* multiplied to the row of part, or NULL */
+    int row;
+    int started;            /* on a thread of its own */
+};
+
+static void * product_run(void *data)
+{
+    product_task * task = (product_task*) data;
+    product_part * part = task->part;
+
+    if (!task->right)
+        cf_matrix_product(part->t, part->n, part->m, part->tmp[0]);
+    else
+        product_row_mul(part->m + 2 * task->row, task->right->m,
+                        part->tmp[task->row]);
+    return NULL;
+}
+
+/*
+ * Run the tasks, all but the last on threads of their own.  A task whose
+ * thread can not be started is run in place.
+ */
+static void product_run_all(product_task *tasks, pthread_t *tids, int n)
+{
+    int i;
+
+    for (i = 0; i < n - 1; ++i)
+    {
+        tasks[i].started =
+            pthread_create(&tids[i], NULL, product_run, &tasks[i]) == 0;
+        if (!tasks[i].started)
+            product_run(&tasks[i]);
+    }
+    product_run(&tasks[n - 1]);
+    for (i = 0; i < n - 1; ++i)
+    {
+        if (tasks[i].started)
+            pthread_join(tids[i], NULL);
+    }
+}
+
+void cf_matrix_product_threads(const long long *t, size_t n, mpz_t *m,
+                               int threads)
+{
+    product_part * parts = NULL;
+    product_task * tasks = NULL;
+    pthread_t * tids = NULL;
+    size_t start = 0;
+    int i, count, step;
+
+    if (threads > 1 && (size_t)threads > n / PRODUCT_THREAD_TERMS)
+        threads = (int)(n / PRODUCT_THREAD_TERMS);
+    if (threads > 1)
+    {
+        parts = (product_part*)malloc(threads * sizeof(product_part));
+        tasks = (product_task*)malloc(threads * sizeof(product_task));
+        tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    }
+    if (!parts || !tasks || !tids)
+    {
+        mpz_t tmp;
+
+        free(parts);
+        free(tasks);
+        free(tids);
+        mpz_init(tmp);
+        cf_matrix_product(t, n, m, tmp);
+        mpz_clear(tmp);
+        return;
+    }
+
+    for (i = 0; i < threads; ++i)
+    {
+        size_t end = n * (i + 1) / threads;
+
+        parts[i].t = t + start;
+        parts[i].n = end - start;
+        start = end;
+        mpz_inits(parts[i].m[0], parts[i].m[1], parts[i].m[2], parts[i].m[3],
+                  parts[i].tmp[0], parts[i].tmp[1], NULL);
+        tasks[i].part = &parts[i];
+        tasks[i].right = NULL;
+    }
+    product_run_all(tasks, tids, threads);
+
+    /* parts i and i + step into part i, with two rows per pair */
+    for (step = 1; step < threads; step *= 2)
+    {
+        count = 0;
+        for (i = 0; i + step < threads; i += 2 * step)
+        {
+            tasks[count].part = &parts[i];
+            tasks[count].right = &parts[i + step];
+            tasks[count++].row = 0;
+            tasks[count].part = &parts[i];
+            tasks[count].right = &parts[i + step];
+            tasks[count++].row = 1;
+        }
+        product_run_all(tasks, tids, count);
+    }
+
+    for (i = 0; i < 4; ++i)
+    {
+        mpz_swap(m[i], parts[0].m[i]);
+    }
+    for (i = 0; i < threads; ++i)
+    {
+        mpz_clears(parts[i].m[0], parts[i].m[1], parts[i].m[2], parts[i].m[3],
+                   parts[i].tmp[0], parts[i].tmp[1], NULL);
+    }
+    free(parts);
+    free(tasks);
+    free(tids);
+}
+
+int cf_convergent_at_threads(const cf *c, size_t k, mpz_t p, mpz_t q,
+                             int threads)
+{
+    size_t n = 0, size = PRODUCT_READ_TERMS, got, i;
+    long long * terms;
+    mpz_t m[4];
+    cf * x;
+
+    if (k == (size_t)-1)
+        return -1;
+    if (size > k + 1)
+        size = k + 1;
+    terms = (long long*)malloc(size * sizeof(long long));
+    x = cf_copy(c);
+    if (!terms || !x)
+    {
+        free(terms);
+        if (x)
+            cf_free(x);
+        return -1;
+    }
+
+    /*
+     * The terms up to a_k, and the CF ends before LLONG_MAX.  The buffer
+     * is doubled as the terms come, so that a CF which ends early does not
+     * cost the memory of k terms.
+     */
+    while ((got = cf_next_terms(x, terms + n, size - n)) > 0)
+    {
+        for (i = 0; i < got && terms[n] != LLONG_MAX; ++i)
+        {
+            ++n;
+        }
+        if (i < got || n == k + 1)
+            break;
+        if (n == size)
+        {
+            size_t grown = size <= (k + 1) / 2 ? size * 2 : k + 1;
+            long long * t = NULL;
+
+            if (grown <= SIZE_MAX / sizeof(long long))
+                t = (long long*)realloc(terms, grown * sizeof(long long));
+            if (!t)
+            {
+                free(terms);
+                cf_free(x);
+                return -1;
+            }
+            terms = t;
+            size = grown;
+        }
+    }
+    cf_free(x);
+
+    mpz_inits(m[0], m[1], m[2], m[3], NULL);
+    cf_matrix_product_threads(terms, n, m, threads);
+    free(terms);
+    mpz_swap(p, m[0]);
+    mpz_swap(q, m[2]);
+    mpz_clears(m[0], m[1], m[2], m[3], NULL);
+    return n == k + 1 ? 0 : 1;
+}
+
+int cf_convergent_at(const cf *c, size_t k, mpz_t p, mpz_t q)
+{
+    return cf_convergent_at_threads(c, k, p, q, 1);
+}
@@ -0,0 +1,418 @@
+/**
+ * periodic continued fractions of quadratic irrationals.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+#include "cf.h"
+#include "common.h"
+#include "cf_mpz.h"
+
+/*
+ * Integers of the general surds: they hold the squares of values of 62
+ * bits where the compiler has __int128.
+ */
+#if defined(__SIZEOF_INT128__)
+typedef __int128 quad_int;
+#define QUAD_LIMIT (1ll << 62)
+#else
+typedef long long quad_int;
+#define QUAD_LIMIT (1ll << 30)
+#endif
+
+/*
+ * floor(sqrt(n)), exact for all n: the estimate of double is corrected
+ * in integers.
+ */
+static unsigned long long quad_isqrt(unsigned long long n)
+{
+    unsigned long long r = (unsigned long long)sqrt((double)n);
+
+    if (r > 0xffffffffull)
+        r = 0xffffffffull;
+    while (r * r > n)
+        --r;
+    while (r < 0xffffffffull && (r + 1) * (r + 1) <= n)
+        ++r;
+    return r;
+}
+
+static cf_class _sqrt_n_class;
+
+/*
+ * The rest of sqrt(n) after k terms is (m + sqrt(n)) / d, and its next
+ * term is a = floor((m + a0) / d), a0 = floor(sqrt(n)):
+ *
+ *     m' = d a - m,  d' = (n - m'^2) / d,  a' = floor((a0 + m') / d')
+ *
+ * with 0 <= m <= a0 and 0 < d <= 2 a0 + 1, so every step is a few word
+ * operations and the state never grows.  The expansion is periodic,
+ * [a0; a1, ..., a_{p-1}, 2 a0], and the period ends at the first d = 1
+ * after the first term.
+ */
+typedef struct _sqrt_n sqrt_n;
+struct _sqrt_n {
+    cf base;
+    unsigned long long n, a0;
+    unsigned long long m, d, a;
+    size_t index;       /* terms retrieved */
+    size_t period;      /* 0 while not known */
+};
+
+static inline void sqrt_n_step(const sqrt_n *s, unsigned long long *m,
+                               unsigned long long *d, unsigned long long *a)
+{
+    *m = *d * *a - *m;
+    *d = (s->n - *m * *m) / *d;
+    *a = (s->a0 + *m) / *d;
+}
+
+static int sqrt_n_is_finished(const cf *c)
+{
+    sqrt_n * s = (sqrt_n*) c;
+    /* only the root of a square is finished, after its single term */
+    return s->a0 * s->a0 == s->n && s->index > 0;
+}
+
+static long long sqrt_n_next_term(cf *c)
+{
+    sqrt_n * s = (sqrt_n*) c;
+    long long term;
+
+    if (sqrt_n_is_finished(c))
+        return LLONG_MAX;
+
+    term = (long long)s->a;
+    ++s->index;
+    if (s->a0 * s->a0 != s->n)
+    {
+        sqrt_n_step(s, &s->m, &s->d, &s->a);
+        if (s->d == 1 && !s->period)
+            s->period = s->index;
+    }
+    return term;
+}
+
+static size_t sqrt_n_next_terms(cf *c, long long *buf, size_t n)
+{
+    sqrt_n * s = (sqrt_n*) c;
+    size_t i;
+
+    if (sqrt_n_is_finished(c))
+        return 0;
+    if (s->a0 * s->a0 == s->n)
+    {
+        if (n == 0)
+            return 0;
+        buf[0] = sqrt_n_next_term(c);
+        return 1;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        buf[i] = (long long)s->a;
+        sqrt_n_step(s, &s->m, &s->d, &s->a);
+        if (s->d == 1 && !s->period)
+            s->period = s->index + i + 1;
+    }
+    s->index += n;
+    return n;
+}
+
+static void sqrt_n_free(cf *c)
+{
+    free(c);
+}
+
+static cf * sqrt_n_copy(const cf *c)
+{
+    sqrt_n * copy = (sqrt_n*)malloc(sizeof(sqrt_n));
+    if (!copy)
+        return NULL;
+    *copy = *(const sqrt_n*)c;
+    return &copy->base;
+}
+
+static cf_class _sqrt_n_class = {
+    sqrt_n_next_term,
+    sqrt_n_is_finished,
+    sqrt_n_free,
+    sqrt_n_copy,
+    sqrt_n_next_terms
+};
+
+cf * cf_create_from_sqrt_n(unsigned long long n)
+{
+    sqrt_n * s = (sqrt_n*)malloc(sizeof(sqrt_n));
+    if (!s)
+        return NULL;
+
+    s->base.object_class = &_sqrt_n_class;
+    s->n = n;
+    s->a0 = quad_isqrt(n);
+    s->m = 0;
+    s->d = 1;
+    s->a = s->a0;
+    s->index = 0;
+    s->period = 0;
+    return &s->base;
+}
+
+static cf_class _quad_class;
+
+/*
+ * The rest of the value after k terms is (P + sqrt(D)) / Q, with Q a
+ * divisor of D - P^2, and its next term is a = floor((P + sqrt(D)) / Q):
+ *
+ *     P' = a Q - P,  Q' = (D - P'^2) / Q
+ *
+ * The rest is reduced when it is > 1 and its conjugate is in (-1, 0),
+ * that is 0 < P <= s, s - P < Q <= s + P for s = floor(sqrt(D)).  The
+ * expansion of a reduced value is purely periodic, so the period starts
+ * at the first reduced rest, and P and Q are bounded by 2 s from there.
+ */
+typedef struct _quad quad;
+struct _quad {
+    cf base;
+    quad_int d, s;      /* D and floor(sqrt(D)) */
+    quad_int p, q;
+    quad_int p0, q0;    /* the value itself, for cf_get_period() */
+    int overflow;
+    size_t pre_period, period;  /* period 0 while not known */
+};
+
+static inline quad_int quad_fdiv(quad_int a, quad_int b)
+{
+    quad_int q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+/*
+ * One step from (p, q), giving the term in *a.
+ *
+ * Returns -1 if the integers overflow, and nothing is changed then.
+ */
+static int quad_step(const quad *x, quad_int *p, quad_int *q, quad_int *a)
+{
+    quad_int t, p1, q1;
+
+    /* sqrt(D) is irrational, in (s, s + 1) */
+    t = *q > 0 ? quad_fdiv(*p + x->s, *q) : quad_fdiv(-*p - x->s - 1, -*q);
+    if (__builtin_mul_overflow(t, *q, &p1) ||
+        __builtin_sub_overflow(p1, *p, &p1) ||
+        __builtin_mul_overflow(p1, p1, &q1) ||
+        __builtin_sub_overflow(x->d, q1, &q1))
+        return -1;
+    *a = t;
+    *p = p1;
+    *q = q1 / *q;
+    return 0;
+}
+
+static int quad_is_reduced(const quad *x, quad_int p, quad_int q)
+{
+    return p > 0 && p <= x->s && x->s - p < q && q <= x->s + p;
+}
+
+static long long quad_next_term(cf *c)
+{
+    quad * x = (quad*) c;
+    quad_int a;
+
+    if (x->overflow)
+        return LLONG_MAX;
+    if (quad_step(x, &x->p, &x->q, &a) != 0 || a >= LLONG_MAX || a < LLONG_MIN)
+    {
+        /* out of the range of the integers, stop here */
+        x->overflow = 1;
+        return LLONG_MAX;
+    }
+    return (long long)a;
+}
+
+static int quad_is_finished(const cf *c)
+{
+    return ((const quad*) c)->overflow;
+}
+
+static size_t quad_next_terms(cf *c, long long *buf, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n && !quad_is_finished(c); ++i)
+    {
+        buf[i] = quad_next_term(c);
+    }
+    return i;
+}
+
+static void quad_free(cf *c)
+{
+    free(c);
+}
+
+static cf * quad_copy(const cf *c)
+{
+    quad * copy = (quad*)malloc(sizeof(quad));
+    if (!copy)
+        return NULL;
+    *copy = *(const quad*)c;
+    return &copy->base;
+}
+
+static cf_class _quad_class = {
+    quad_next_term,
+    quad_is_finished,
+    quad_free,
+    quad_copy,
+    quad_next_terms
+};
+
+static quad_int quad_abs(quad_int v)
+{
+    return v < 0 ? -v : v;
+}
+
+/*
+ * (p + q sqrt(n)) / r of a square n or of q = 0, which is rational.
+ */
+static cf * quad_create_rational(long long p, long long q,
+                                 unsigned long long s, long long r)
+{
+    mpz_t num, den;
+    cf * c;
+
+    mpz_inits(num, den, NULL);
+    mpz_set_ll(num, q);
+    mpz_set_ull(den, s);
+    mpz_mul(num, num, den);
+    mpz_set_ll(den, p);
+    mpz_add(num, num, den);
+    mpz_set_ll(den, r);
+    c = cf_create_from_mpz_fraction(num, den);
+    mpz_clears(num, den, NULL);
+    return c;
+}
+
+cf * cf_create_from_quadratic(long long p, long long q,
+                              unsigned long long n, long long r)
+{
+    unsigned long long s = quad_isqrt(n);
+    quad_int qq = q, d, dp, pp = p, rr = r;
+    int of;
+    quad * x;
+
+    if (q == 0 || s * s == n)
+        return quad_create_rational(p, q, s, r);
+
+    if (qq < 0)
+    {
+        qq = -qq;
+        pp = -pp;
+        rr = -rr;
+    }
+
+    /* (p + sqrt(q^2 n)) / r, scaled by |r| unless r divides D - p^2 */
+    of = __builtin_mul_overflow(qq, qq, &d) ||
+         __builtin_mul_overflow(d, (quad_int)n, &d) ||
+         __builtin_mul_overflow(pp, pp, &dp) ||
+         __builtin_sub_overflow(d, dp, &dp);
+    if (!of && dp % rr != 0)
+    {
+        quad_int m = quad_abs(rr);
+        of = __builtin_mul_overflow(d, m, &d) ||
+             __builtin_mul_overflow(d, m, &d) ||
+             __builtin_mul_overflow(pp, m, &pp) ||
+             __builtin_mul_overflow(rr, m, &rr);
+    }
+    if (of || d > QUAD_LIMIT ||
+        quad_abs(pp) > QUAD_LIMIT || quad_abs(rr) > QUAD_LIMIT)
+    {
+        /* too large for the integers, evaluate it by a homographic */
+        cf * root = cf_create_from_sqrt_n(n);
+        cf * c = root ? cf_create_from_homographic(root, q, p, 0, r) : NULL;
+        cf_free(root);
+        return c;
+    }
+
+    x = (quad*)malloc(sizeof(quad));
+    if (!x)
+        return NULL;
+    x->base.object_class = &_quad_class;
+    x->d = d;
+    x->s = quad_isqrt((unsigned long long)d);
+    x->p = x->p0 = pp;
+    x->q = x->q0 = rr;
+    x->overflow = 0;
+    x->pre_period = x->period = 0;
+    return &x->base;
+}
+
+/*
+ * Walk from the value to the first reduced rest, and then around the
+ * period.  The cost is the length of the pre-period and the period.
+ */
+static int quad_get_period(quad *x)
+{
+    quad_int p = x->p0, q = x->q0, p1, q1, a;
+    size_t k = 0;
+
+    while (!quad_is_reduced(x, p, q))
+    {
+        if (quad_step(x, &p, &q, &a) != 0)
+            return -1;
+        ++k;
+    }
+    x->pre_period = k;
+    p1 = p;
+    q1 = q;
+    k = 0;
+    do
+    {
+        quad_step(x, &p, &q, &a);
+        ++k;
+    } while (p != p1 || q != q1);
+    x->period = k;
+    return 0;
+}
+
+int cf_get_period(const cf *c, size_t *pre_period, size_t *period)
+{
+    if (c->object_class == &_quad_class)
+    {
+        quad * x = (quad*) c;
+        if (!x->period && quad_get_period(x) != 0)
+            return -1;
+        *pre_period = x->pre_period;
+        *period = x->period;
+        return 0;
+    }
+    else if (c->object_class == &_sqrt_n_class)
+    {
+        sqrt_n * s = (sqrt_n*) c;
+
+        *pre_period = 1;
+        if (s->a0 * s->a0 == s->n)
+        {
+            *period = 0;
+            return 0;
+        }
+        if (!s->period)
+        {
+            /* walk the period from the start, the state is small */
+            unsigned long long m = 0, d = 1, a = s->a0;
+            size_t k = 0;
+            do
+            {
+                sqrt_n_step(s, &m, &d, &a);
+                ++k;
+            } while (d != 1);
+            s->period = k;
+        }
+        *period = s->period;
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,264 @@
+/**
+ * all the convergents of an array of terms, by a parallel scan.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "cf.h"
+#include "common.h"
+#include "cf_mpz.h"
+
+/* terms of a chunk, the unit of work of the threads */
+#define SCAN_CHUNK_TERMS 1024
+
+/*
+ * With M_j the product of the matrices [a_i 1; 1 0] of chunk j, the
+ * convergents before chunk j are
+ *
+ *     [p_{s-1} p_{s-2}; q_{s-1} q_{s-2}] = M_0 M_1 ... M_{j-1},
+ *
+ * so the scan is done in three passes:
+ *
+ *  1. the products M_j of all chunks, in parallel;
+ *  2. the last two convergents of each chunk, from those of the chunk
+ *     before and M_j, in order;
+ *  3. the convergents inside each chunk by the recurrence
+ *     p_i = a_i p_{i-1} + p_{i-2}, in parallel.
+ *
+ * The convergents between chunks are written in place by the second
+ * pass, so no integers are kept beside the output.
+ */
+typedef struct _scan scan;
+struct _scan {
+    const long long * terms;
+    size_t n;
+    mpz_t * p;
+    mpz_t * q;
+    size_t chunks;
+    mpz_t (* m)[4];     /* M_j */
+    int pass;
+    size_t next;        /* the next chunk to take */
+};
+
+static inline size_t scan_chunk_start(const scan *s, size_t j)
+{
+    return s->n / s->chunks * j;
+}
+
+static inline size_t scan_chunk_end(const scan *s, size_t j)
+{
+    return j + 1 == s->chunks ? s->n : s->n / s->chunks * (j + 1);
+}
+
+/*
+ * The product of a chunk.  Runs of terms are multiplied in long long as
+ * far as they do not overflow, and each run is then multiplied to the
+ * product in mpz: a run is a few dozen terms, where the numbers of the
+ * product are small and most of the work is in the runs.
+ */
+static void scan_chunk_product(scan *s, size_t j, mpz_t *r, mpz_t tmp)
+{
+    const long long * t = s->terms;
+    size_t i = scan_chunk_start(s, j), end = scan_chunk_end(s, j);
+    mpz_t * m = s->m[j];
+
+    mpz_set_ui(m[0], 1u);
+    mpz_set_ui(m[1], 0u);
+    mpz_set_ui(m[2], 0u);
+    mpz_set_ui(m[3], 1u);
+    while (i < end)
+    {
+        /* a single term never overflows */
+        long long r0 = 1, r1 = 0, r2 = 0, r3 = 1;
+
+        for (; i < end; ++i)
+        {
+            long long n0, n2;
+
+            if (__builtin_mul_overflow(r0, t[i], &n0) ||
+                __builtin_add_overflow(n0, r1, &n0) ||
+                __builtin_mul_overflow(r2, t[i], &n2) ||
+                __builtin_add_overflow(n2, r3, &n2))
+                break;
+            r1 = r0;
+            r0 = n0;
+            r3 = r2;
+            r2 = n2;
+        }
+        mpz_set_ll(r[0], r0);
+        mpz_set_ll(r[1], r1);
+        mpz_set_ll(r[2], r2);
+        mpz_set_ll(r[3], r3);
+        cf_matrix_mul(m, r, tmp);
+    }
+}
+
+/*
+ * z = z1 a + z2.
+ */
+static inline void scan_step(mpz_t z, mpz_srcptr z1, long long a,
+                             mpz_srcptr z2, mpz_t tmp)
+{
+    mpz_set_ll(tmp, a);
+    mpz_mul(z, z1, tmp);
+    mpz_add(z, z, z2);
+}
+
+/*
+ * The convergents of a chunk but the last two, which the second pass has
+ * written, as the two before the chunk.
+ */
+static void scan_chunk_fill(scan *s, size_t j, mpz_t tmp)
+{
+    const long long * t = s->terms;
+    size_t i = scan_chunk_start(s, j), end = scan_chunk_end(s, j);
+
+    for (; i + 2 < end; ++i)
+    {
+        if (i == 0)
+        {
+            /* p_{-1} / q_{-1} = 1 / 0, and p_{-2} / q_{-2} = 0 / 1 */
+            mpz_set_ll(s->p[0], t[0]);
+            mpz_set_ui(s->q[0], 1u);
+        }
+        else if (i == 1)
+        {
+            mpz_set_ll(s->q[1], t[1]);
+            mpz_mul(s->p[1], s->p[0], s->q[1]);
+            mpz_add_ui(s->p[1], s->p[1], 1u);
+        }
+        else
+        {
+            scan_step(s->p[i], s->p[i - 1], t[i], s->p[i - 2], tmp);
+            scan_step(s->q[i], s->q[i - 1], t[i], s->q[i - 2], tmp);
+        }
+    }
+}
+
+/*
+ * The second pass: [p_{e-1} p_{e-2}; q_{e-1} q_{e-2}] of chunk j is
+ * [p_{s-1} p_{s-2}; q_{s-1} q_{s-2}] M_j.  There is a chunk before j
+ * only if all are of SCAN_CHUNK_TERMS terms or more.
+ */
+static void scan_boundaries(scan *s)
+{
+    size_t j;
+
+    for (j = 0; j < s->chunks; ++j)
+    {
+        size_t start = scan_chunk_start(s, j), e = scan_chunk_end(s, j);
+        mpz_t * m = s->m[j];
+
+        if (j == 0)
+        {
+            mpz_swap(s->p[e - 1], m[0]);
+            mpz_swap(s->q[e - 1], m[2]);
+            if (e >= 2)
+            {
+                mpz_swap(s->p[e - 2], m[1]);
+                mpz_swap(s->q[e - 2], m[3]);
+            }
+            continue;
+        }
+        mpz_mul(s->p[e - 1], s->p[start - 1], m[0]);
+        mpz_addmul(s->p[e - 1], s->p[start - 2], m[2]);
+        mpz_mul(s->p[e - 2], s->p[start - 1], m[1]);
+        mpz_addmul(s->p[e - 2], s->p[start - 2], m[3]);
+        mpz_mul(s->q[e - 1], s->q[start - 1], m[0]);
+        mpz_addmul(s->q[e - 1], s->q[start - 2], m[2]);
+        mpz_mul(s->q[e - 2], s->q[start - 1], m[1]);
+        mpz_addmul(s->q[e - 2], s->q[start - 2], m[3]);
+    }
+}
+
+/*
+ * The threads of a pass take the chunks one by one, so that a thread
+ * with large numbers to work out does not hold back the others.
+ */
+static void * scan_worker(void *data)
+{
+    scan * s = (scan*) data;
+    mpz_t r[4], tmp;
+    size_t j;
+
+    mpz_inits(r[0], r[1], r[2], r[3], tmp, NULL);
+    while ((j = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED)) < s->chunks)
+    {
+        if (s->pass == 1)
+            scan_chunk_product(s, j, r, tmp);
+        else
+            scan_chunk_fill(s, j, tmp);
+    }
+    mpz_clears(r[0], r[1], r[2], r[3], tmp, NULL);
+    return NULL;
+}
+
+/*
+ * Run a pass on the calling thread and up to threads - 1 more.
+ */
+static void scan_run(scan *s, int pass, pthread_t *tids, int threads)
+{
+    int i, started;
+
+    s->pass = pass;
+    s->next = 0;
+    for (started = 0; started < threads - 1; ++started)
+    {
+        if (pthread_create(&tids[started], NULL, scan_worker, s) != 0)
+            break;
+    }
+    scan_worker(s);
+    for (i = 0; i < started; ++i)
+    {
+        pthread_join(tids[i], NULL);
+    }
+}
+
+int cf_convergents_scan(const long long *terms, size_t n,
+                        mpz_t *p, mpz_t *q, int threads)
+{
+    pthread_t * tids = NULL;
+    scan s;
+    size_t j;
+
+    if (n == 0)
+        return 0;
+    s.terms = terms;
+    s.n = n;
+    s.p = p;
+    s.q = q;
+    s.chunks = n / SCAN_CHUNK_TERMS ? n / SCAN_CHUNK_TERMS : 1;
+    if (threads < 1)
+        threads = 1;
+    if ((size_t)threads > s.chunks)
+        threads = (int)s.chunks;
+
+    s.m = (mpz_t (*)[4])malloc(s.chunks * sizeof(*s.m));
+    if (threads > 1)
+        tids = (pthread_t*)malloc((threads - 1) * sizeof(pthread_t));
+    if (!s.m || (threads > 1 && !tids))
+    {
+        free(s.m);
+        free(tids);
+        return -1;
+    }
+    for (j = 0; j < s.chunks; ++j)
+    {
+        mpz_inits(s.m[j][0], s.m[j][1], s.m[j][2], s.m[j][3], NULL);
+    }
+
+    scan_run(&s, 1, tids, threads);
+    scan_boundaries(&s);
+    scan_run(&s, 3, tids, threads);
+
+    for (j = 0; j < s.chunks; ++j)
+    {
+        mpz_clears(s.m[j][0], s.m[j][1], s.m[j][2], s.m[j][3], NULL);
+    }
+    free(s.m);
+    free(tids);
+    return 0;
+}
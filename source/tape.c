@@ -0,0 +1,271 @@
+/**
+ * terms of a continued fraction shared by its copies.
+ *
+ * \date 2026-10-17
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cf.h"
+#include "common.h"
+
+/* terms in a chunk of the tape */
+#define TAPE_CHUNK_TERMS 64
+
+/*
+ * The terms of a CF are recorded on a tape, a list of chunks, as they are
+ * retrieved from it, and any number of cursors read them from the tape.
+ * A copy of a cursor is a cursor at the same place, so the terms are
+ * worked out once for all the copies.
+ *
+ * A chunk is held by the cursors on it and by the chunk before it, and
+ * the last one by the tape too, so the chunks behind all cursors are
+ * freed and the tape only keeps the terms between the last cursor and
+ * the first one.
+ */
+typedef struct _tape_chunk tape_chunk;
+struct _tape_chunk {
+    int refs;
+    size_t len;
+    tape_chunk * next;
+    long long terms[TAPE_CHUNK_TERMS];
+};
+
+typedef struct _tape tape;
+struct _tape {
+    int refs;           /* cursors */
+    cf * x;
+    tape_chunk * tail;
+};
+
+static cf_class _tape_class;
+
+typedef struct _tape_cursor tape_cursor;
+struct _tape_cursor {
+    cf base;
+    tape * t;
+    tape_chunk * chunk;
+    size_t pos;
+};
+
+static tape_chunk * tape_chunk_new(void)
+{
+    tape_chunk * k = (tape_chunk*)malloc(sizeof(tape_chunk));
+    if (!k)
+        return NULL;
+    k->refs = 1;
+    k->len = 0;
+    k->next = NULL;
+    return k;
+}
+
+static void tape_chunk_release(tape_chunk *k)
+{
+    while (k && __atomic_sub_fetch(&k->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        tape_chunk * next = k->next;
+        free(k);
+        k = next;
+    }
+}
+
+/*
+ * Retrieve up to n more terms of the CF onto the tape, as many as the
+ * cursor asks for, so that the terms are not worked out ahead of the
+ * readers.  Returns -1 if nothing could be added.
+ */
+static int tape_pull(tape *t, size_t n)
+{
+    tape_chunk * k = t->tail;
+    size_t got;
+
+    if (cf_is_finished(t->x))
+        return -1;
+    if (k->len == TAPE_CHUNK_TERMS)
+    {
+        tape_chunk * tail = tape_chunk_new();
+        if (!tail)
+            return -1;
+        /* the new chunk is held by the full one, and by the tape */
+        k->next = tail;
+        __atomic_add_fetch(&tail->refs, 1, __ATOMIC_RELAXED);
+        t->tail = tail;
+        tape_chunk_release(k);
+        k = tail;
+    }
+
+    if (n > TAPE_CHUNK_TERMS - k->len)
+        n = TAPE_CHUNK_TERMS - k->len;
+    got = cf_next_terms(t->x, k->terms + k->len, n);
+    k->len += got;
+    return got ? 0 : -1;
+}
+
+/*
+ * Make the cursor have a term at its place, moving to the next chunk or
+ * pulling terms onto the tape.  Returns -1 at the end of the CF.
+ */
+static int tape_cursor_ready(tape_cursor *tc, size_t n)
+{
+    while (tc->pos == tc->chunk->len)
+    {
+        tape_chunk * next = tc->chunk->next;
+
+        if (next)
+        {
+            __atomic_add_fetch(&next->refs, 1, __ATOMIC_RELAXED);
+            tape_chunk_release(tc->chunk);
+            tc->chunk = next;
+            tc->pos = 0;
+        }
+        else if (tape_pull(tc->t, n) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The cursor is the only one and has read all the tape: the terms need
+ * not be recorded for anyone, and are retrieved directly.
+ */
+static inline int tape_cursor_is_alone(const tape_cursor *tc)
+{
+    return __atomic_load_n(&tc->t->refs, __ATOMIC_RELAXED) == 1 &&
+        tc->pos == tc->chunk->len && !tc->chunk->next;
+}
+
+static long long tape_next_term(cf *c)
+{
+    tape_cursor * tc = (tape_cursor*) c;
+
+    if (tape_cursor_is_alone(tc))
+        return cf_next_term(tc->t->x);
+    if (tape_cursor_ready(tc, 1) != 0)
+        return LLONG_MAX;
+    return tc->chunk->terms[tc->pos++];
+}
+
+static size_t tape_next_terms(cf *c, long long *buf, size_t n)
+{
+    tape_cursor * tc = (tape_cursor*) c;
+    size_t i = 0, len;
+
+    while (i < n)
+    {
+        if (tape_cursor_is_alone(tc))
+            return i + cf_next_terms(tc->t->x, buf + i, n - i);
+        if (tape_cursor_ready(tc, n - i) != 0)
+            break;
+        len = tc->chunk->len - tc->pos;
+        if (len > n - i)
+            len = n - i;
+        memcpy(buf + i, tc->chunk->terms + tc->pos, len * sizeof(long long));
+        tc->pos += len;
+        i += len;
+    }
+    return i;
+}
+
+static int tape_is_finished(const cf *c)
+{
+    const tape_cursor * tc = (const tape_cursor*) c;
+    const tape_chunk * k = tc->chunk;
+    size_t pos = tc->pos;
+
+    while (pos == k->len && k->next)
+    {
+        k = k->next;
+        pos = 0;
+    }
+    return pos == k->len && cf_is_finished(tc->t->x);
+}
+
+static void tape_free(cf *c)
+{
+    tape_cursor * tc = (tape_cursor*) c;
+    tape * t = tc->t;
+
+    tape_chunk_release(tc->chunk);
+    if (__atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        tape_chunk_release(t->tail);
+        cf_free(t->x);
+        free(t);
+    }
+    free(tc);
+}
+
+static cf * tape_copy(const cf *c)
+{
+    tape_cursor * copy = (tape_cursor*)malloc(sizeof(tape_cursor));
+
+    if (!copy)
+        return NULL;
+    *copy = *(const tape_cursor*) c;
+    __atomic_add_fetch(&copy->t->refs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&copy->chunk->refs, 1, __ATOMIC_RELAXED);
+    return &copy->base;
+}
+
+static cf_class _tape_class = {
+    tape_next_term,
+    tape_is_finished,
+    tape_free,
+    tape_copy,
+    tape_next_terms
+};
+
+/*
+ * A cursor at the start of a new tape of x, which is taken over.
+ */
+static cf * tape_create(cf *x)
+{
+    tape * t = (tape*)malloc(sizeof(tape));
+    tape_cursor * tc = (tape_cursor*)malloc(sizeof(tape_cursor));
+    tape_chunk * k = tape_chunk_new();
+
+    if (!t || !tc || !k)
+    {
+        free(t);
+        free(tc);
+        free(k);
+        return NULL;
+    }
+    t->refs = 1;
+    t->x = x;
+    t->tail = k;
+    /* the chunk is held by the tape and by the cursor */
+    ++k->refs;
+    tc->base.object_class = &_tape_class;
+    tc->t = t;
+    tc->chunk = k;
+    tc->pos = 0;
+    return &tc->base;
+}
+
+void cf_tape_share(cf **x)
+{
+    cf * tc;
+
+    if ((*x)->object_class == &_tape_class)
+        return;
+    tc = tape_create(*x);
+    if (tc)
+        *x = tc;
+}
+
+cf * cf_create_memo(const cf * x)
+{
+    cf * c = cf_copy(x);
+    cf * tc;
+
+    if (!c || c->object_class == &_tape_class)
+        return c;
+    tc = tape_create(c);
+    if (!tc)
+        cf_free(c);
+    return tc;
+}
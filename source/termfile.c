@@ -0,0 +1,273 @@
+/**
+ * terms of continued fractions in binary files.
+ *
+ * \date 2026-10-17
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cf.h"
+#include "common.h"
+
+#define TERMFILE_MAGIC "CFT1"
+#define TERMFILE_MAGIC_LEN 4
+
+/* terms retrieved at once by the writer */
+#define TERMFILE_TERMS 256
+
+/* bytes of the longest varint of 64 bits */
+#define TERMFILE_VARINT_MAX 10
+
+static size_t termfile_put_varint(unsigned char *p, unsigned long long v)
+{
+    size_t len = 0;
+
+    while (v >= 0x80)
+    {
+        p[len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[len++] = (unsigned char)v;
+    return len;
+}
+
+static inline unsigned long long termfile_zigzag(long long v)
+{
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static inline long long termfile_unzigzag(unsigned long long u)
+{
+    return (long long)(u >> 1) ^ -(long long)(u & 1);
+}
+
+int cf_write_binary_to(cf_sink sink, void *data, const cf *c, size_t max_terms)
+{
+    long long terms[TERMFILE_TERMS];
+    unsigned char buf[TERMFILE_TERMS * TERMFILE_VARINT_MAX];
+    cf_writer w;
+    size_t count = 0;
+    cf * x = cf_copy(c);
+
+    if (!x)
+        return -1;
+
+    cf_writer_init(&w, sink, data);
+    cf_writer_put(&w, TERMFILE_MAGIC, TERMFILE_MAGIC_LEN);
+    while (count < max_terms && !cf_is_finished(x) && !w.error)
+    {
+        size_t n = max_terms - count < TERMFILE_TERMS ?
+                   max_terms - count : TERMFILE_TERMS;
+        size_t i = 0, len = 0;
+
+        n = cf_next_terms(x, terms, n);
+        if (n == 0)
+            break;
+        if (count == 0)
+        {
+            len = termfile_put_varint(buf, termfile_zigzag(terms[0]));
+            i = 1;
+        }
+        for (; i < n; ++i)
+        {
+            if (terms[i] < 1)
+            {
+                /* not canonical, there is no varint of it */
+                w.error = 1;
+                break;
+            }
+            len += termfile_put_varint(buf + len, (unsigned long long)terms[i]);
+        }
+        cf_writer_put(&w, (const char*)buf, len);
+        count += n;
+    }
+
+    buf[0] = 0;
+    buf[1] = cf_is_finished(x) ? 1 : 0;
+    cf_writer_put(&w, (const char*)buf, 2);
+    cf_free(x);
+    return cf_writer_flush(&w);
+}
+
+int cf_write_binary(FILE *f, const cf *c, size_t max_terms)
+{
+    return cf_write_binary_to(cf_file_sink, f, c, max_terms);
+}
+
+/*
+ * A mapped file, shared by the copies of its CF.
+ */
+typedef struct _termfile_map termfile_map;
+struct _termfile_map {
+    int refs;
+    const unsigned char * base;
+    size_t size;
+};
+
+static cf_class _termfile_class;
+
+typedef struct _termfile termfile;
+struct _termfile {
+    cf base;
+    termfile_map * map;
+    size_t pos, end;    /* the terms not retrieved */
+    size_t index;       /* terms retrieved */
+};
+
+/*
+ * Decode the next term, or end the CF with LLONG_MAX if it is damaged.
+ */
+static long long termfile_decode(termfile *tf)
+{
+    const unsigned char * p = tf->map->base;
+    unsigned long long u = 0;
+    int shift = 0;
+
+    while (tf->pos < tf->end)
+    {
+        unsigned char b = p[tf->pos++];
+
+        if (shift == 63 && b > 1)
+            break;
+        u |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            if (tf->index++ == 0)
+                return termfile_unzigzag(u);
+            if (u == 0 || u > LLONG_MAX)
+                break;
+            return (long long)u;
+        }
+        shift += 7;
+    }
+    tf->pos = tf->end;
+    return LLONG_MAX;
+}
+
+static long long termfile_next_term(cf *c)
+{
+    termfile * tf = (termfile*) c;
+
+    if (tf->pos >= tf->end)
+        return LLONG_MAX;
+    return termfile_decode(tf);
+}
+
+static int termfile_is_finished(const cf *c)
+{
+    const termfile * tf = (const termfile*) c;
+    return tf->pos >= tf->end;
+}
+
+static size_t termfile_next_terms(cf *c, long long *buf, size_t n)
+{
+    termfile * tf = (termfile*) c;
+    const unsigned char * p = tf->map->base;
+    size_t i;
+
+    for (i = 0; i < n && tf->pos < tf->end; ++i)
+    {
+        /* terms below 128 take a byte */
+        if (tf->index > 0 && p[tf->pos] - 1u < 0x7fu)
+        {
+            buf[i] = p[tf->pos++];
+            ++tf->index;
+        }
+        else
+        {
+            buf[i] = termfile_decode(tf);
+        }
+    }
+    return i;
+}
+
+static void termfile_free(cf *c)
+{
+    termfile * tf = (termfile*) c;
+
+    if (__atomic_sub_fetch(&tf->map->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        munmap((void*)tf->map->base, tf->map->size);
+        free(tf->map);
+    }
+    free(tf);
+}
+
+static cf * termfile_copy(const cf *c)
+{
+    termfile * copy = (termfile*)malloc(sizeof(termfile));
+
+    if (!copy)
+        return NULL;
+    *copy = *(const termfile*) c;
+    __atomic_add_fetch(&copy->map->refs, 1, __ATOMIC_RELAXED);
+    return &copy->base;
+}
+
+static cf_class _termfile_class = {
+    termfile_next_term,
+    termfile_is_finished,
+    termfile_free,
+    termfile_copy,
+    termfile_next_terms
+};
+
+cf * cf_create_from_file(const char *path, int *is_complete)
+{
+    termfile_map * map;
+    termfile * tf;
+    struct stat st;
+    void * base;
+    const unsigned char * p;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < TERMFILE_MAGIC_LEN + 2)
+    {
+        close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    /* the magic, and the zero byte with the finished flag at the end */
+    p = (const unsigned char*)base;
+    if (memcmp(p, TERMFILE_MAGIC, TERMFILE_MAGIC_LEN) != 0 ||
+        p[st.st_size - 2] != 0 || p[st.st_size - 1] > 1)
+    {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    map = (termfile_map*)malloc(sizeof(termfile_map));
+    tf = (termfile*)malloc(sizeof(termfile));
+    if (!map || !tf)
+    {
+        free(map);
+        free(tf);
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    map->refs = 1;
+    map->base = p;
+    map->size = (size_t)st.st_size;
+    tf->base.object_class = &_termfile_class;
+    tf->map = map;
+    tf->pos = TERMFILE_MAGIC_LEN;
+    tf->end = map->size - 2;
+    tf->index = 0;
+    if (is_complete)
+        *is_complete = p[map->size - 1];
+    return &tf->base;
+}
@@ -0,0 +1,149 @@
+/**
+ * output of continued fractions in blocks to sinks.
+ *
+ * \date 2026-10-17
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cf.h"
+#include "common.h"
+
+void cf_writer_init(cf_writer *w, cf_sink sink, void *data)
+{
+    w->sink = sink;
+    w->data = data;
+    w->len = 0;
+    w->error = 0;
+}
+
+int cf_writer_flush(cf_writer *w)
+{
+    if (w->len && !w->error && w->sink(w->buf, w->len, w->data) != 0)
+        w->error = 1;
+    w->len = 0;
+    return w->error ? -1 : 0;
+}
+
+void cf_writer_put(cf_writer *w, const char *s, size_t n)
+{
+    while (n > 0 && !w->error)
+    {
+        size_t k = CF_WRITE_BLOCK - w->len;
+        if (k > n)
+            k = n;
+        memcpy(w->buf + w->len, s, k);
+        w->len += k;
+        s += k;
+        n -= k;
+        if (w->len == CF_WRITE_BLOCK)
+            cf_writer_flush(w);
+    }
+}
+
+int cf_string_sink(const char *buf, size_t len, void *data)
+{
+    cf_string * str = (cf_string*) data;
+
+    if (str->len + len + 1 > str->cap)
+    {
+        size_t cap = str->cap ? str->cap : 64;
+        char * s;
+        while (str->len + len + 1 > cap)
+            cap *= 2;
+        s = (char*)realloc(str->s, cap);
+        if (!s)
+            return -1;
+        str->s = s;
+        str->cap = cap;
+    }
+    memcpy(str->s + str->len, buf, len);
+    str->len += len;
+    str->s[str->len] = '\0';
+    return 0;
+}
+
+int cf_file_sink(const char *buf, size_t len, void *data)
+{
+    return fwrite(buf, 1, len, (FILE*) data) == len ? 0 : -1;
+}
+
+int cf_write_float(FILE *f, const cf *c, int max_digits)
+{
+    return cf_write_float_to(cf_file_sink, f, c, max_digits);
+}
+
+/*
+ * Format v in decimal at p, without '\0'.  Returns the length.
+ */
+static size_t writer_format_ll(char *p, long long v)
+{
+    char buf[24], *q = buf + sizeof(buf);
+    unsigned long long u = v < 0 ? -(unsigned long long)v : (unsigned long long)v;
+    size_t len;
+
+    do
+    {
+        *--q = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        *--q = '-';
+    len = buf + sizeof(buf) - q;
+    memcpy(p, q, len);
+    return len;
+}
+
+/* terms retrieved at once by the writers */
+#define WRITER_TERMS 256
+
+int cf_write_canonical_to(cf_sink sink, void *data, const cf *c, int max_terms)
+{
+    long long terms[WRITER_TERMS];
+    char buf[32];
+    cf_writer w;
+    size_t count = 0;
+    int finished = 0;
+    cf * x = cf_copy(c);
+
+    if (!x)
+        return -1;
+
+    cf_writer_init(&w, sink, data);
+    while (max_terms > 0 && !finished && !w.error)
+    {
+        size_t n = max_terms < WRITER_TERMS ? (size_t)max_terms : WRITER_TERMS;
+        size_t i;
+
+        n = cf_next_terms(x, terms, n);
+        if (n == 0)
+            break;
+        max_terms -= (int)n;
+        for (i = 0; i < n; ++i)
+        {
+            size_t len = 0;
+
+            buf[len++] = count ? ' ' : '[';
+            len += writer_format_ll(buf + len, terms[i]);
+            /* the last term of the CF has no separator */
+            finished = i + 1 == n && cf_is_finished(x);
+            if (!finished)
+                buf[len++] = count ? ',' : ';';
+            cf_writer_put(&w, buf, len);
+            ++count;
+        }
+    }
+
+    if (count)
+        cf_writer_puts(&w, finished ? "]" : " ...]");
+    else
+        cf_writer_puts(&w, "[NAN]");
+    cf_free(x);
+    return cf_writer_flush(&w);
+}
+
+int cf_write_canonical(FILE *f, const cf *c, int max_terms)
+{
+    return cf_write_canonical_to(cf_file_sink, f, c, max_terms);
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cf.h"
+
+/*
+ * Benchmark of cf_get_gcd() and cf_get_gcd_batch().
+ *
+ * USAGE: bench_gcd [pairs] [rounds]
+ *
+ * Set CF_GCD_ISA=scalar, avx2 or avx512 to choose the batch kernel.
+ */
+
+static long long euclid_gcd(long long a, long long b)
+{
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+    while (b)
+    {
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned long long rng = 88172645463325252ull;
+
+static long long random_ll(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (long long)(rng >> (rng & 31));
+}
+
+int main(int argc, char ** argv)
+{
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    long long *a = malloc(n * sizeof(long long));
+    long long *b = malloc(n * sizeof(long long));
+    long long *out = malloc(n * sizeof(long long));
+    long long *ref = calloc(n, sizeof(long long));
+    const char * isa = getenv("CF_GCD_ISA");
+    double t, t_euclid, t_single, t_batch;
+    size_t i;
+    int r;
+
+    if (!a || !b || !out || !ref)
+        return 1;
+
+    for (i = 0; i < n; ++i)
+    {
+        /* share some factors */
+        long long f = 1 + (random_ll() & 1023);
+        a[i] = (random_ll() >> 12) * f;
+        b[i] = (random_ll() >> 12) * f;
+        if (i & 1)
+            a[i] = -a[i];
+    }
+
+    t = seconds();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < n; ++i)
+            ref[i] = euclid_gcd(a[i], b[i]);
+    t_euclid = seconds() - t;
+
+    t = seconds();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < n; ++i)
+            out[i] = cf_get_gcd(a[i], b[i]);
+    t_single = seconds() - t;
+    if (memcmp(out, ref, n * sizeof(long long)) != 0)
+    {
+        printf("cf_get_gcd: wrong result\n");
+        return 1;
+    }
+
+    t = seconds();
+    for (r = 0; r < rounds; ++r)
+        cf_get_gcd_batch(a, b, out, n);
+    t_batch = seconds() - t;
+    if (memcmp(out, ref, n * sizeof(long long)) != 0)
+    {
+        printf("cf_get_gcd_batch: wrong result\n");
+        return 1;
+    }
+
+    printf("%zu pairs x %d rounds\n", n, rounds);
+    printf("  euclid (%%)          %8.2f ns/pair\n", t_euclid * 1e9 / n / rounds);
+    printf("  cf_get_gcd          %8.2f ns/pair\n", t_single * 1e9 / n / rounds);
+    printf("  cf_get_gcd_batch    %8.2f ns/pair (%s)\n", t_batch * 1e9 / n / rounds,
+           isa ? isa : "auto");
+    return 0;
+}
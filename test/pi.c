@@ -16,7 +16,6 @@ int main(int argc, char ** argv)
 {
     int digits = 100;
     cf  *c;
-    char * s;
     if (argc > 1)
     {
         if ( strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
@@ -33,11 +32,10 @@ int main(int argc, char ** argv)
     printf("calculate pi to %d digits...:\n", digits);
 
     c = cf_create_from_pi();
-    s = cf_convert_to_string_float(c, digits);
-    printf("%s\n", s);
+    cf_write_float(stdout, c, digits);
+    printf("\n");
 
     cf_free(c);
-    free(s);
 
     return 0;
 }
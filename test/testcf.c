@@ -2,8 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "cf.h"
+#include "integer.h"
+#include "cf_mpz.h"
 
 #define FORMAT_FAIL  "[1m[31m"
 #define FORMAT_OK    "[1m[32m"
@@ -602,6 +607,42 @@ static int test_case_gcd(void)
         ASSERT( gcd == 120 );
     }
 
+    ASSERT( cf_get_gcd(0, -5) == 5 );
+    ASSERT( cf_get_gcd(-5, 0) == 5 );
+    ASSERT( cf_get_gcd(0, 0) == 0 );
+    ASSERT( cf_get_gcd(LLONG_MIN, 6) == 2 );
+    ASSERT( cf_get_gcd(LLONG_MIN, 0) == LLONG_MIN );
+    ASSERT( cf_get_gcd(LLONG_MIN, LLONG_MIN) == LLONG_MIN );
+    ASSERT( cf_get_gcd(LLONG_MAX, LLONG_MAX - 1) == 1 );
+
+    /* batches, with a tail shorter than a vector */
+    {
+        long long x[43], y[43], g[43];
+        unsigned long long r = 12345;
+        int i;
+
+        for (i = 0; i < 43; ++i)
+        {
+            r = r * 6364136223846793005ull + 1442695040888963407ull;
+            x[i] = (long long)((r >> (r & 15)) * (i + 1));
+            y[i] = (long long)((r >> 20) * (i + 1)) * (i & 1 ? -1 : 1);
+        }
+        x[3] = 0;
+        y[5] = 0;
+        x[7] = y[7] = 0;
+        x[9] = LLONG_MIN;
+        y[11] = LLONG_MIN + 1;
+        x[13] = y[13] = 1ll << 40;
+        x[15] = LLONG_MIN;
+        y[15] = 0;
+
+        cf_get_gcd_batch(x, y, g, 43);
+        for (i = 0; i < 43; ++i)
+        {
+            ASSERT( g[i] == cf_get_gcd(x[i], y[i]) );
+        }
+    }
+
     return 0;
 }
 
@@ -839,6 +880,1502 @@ static int test_case_best_rational_in_interval(void)
     return 0;
 }
 
+static int test_case_bihomo_pre(void)
+{
+    /* [1; 1, 1, ...] / [1; 2, 2, ...] ~ phi / sqrt(2) */
+    long long ones[400], twos[400];
+    cf * x, * y, * c, * c2;
+    char * s1, * s2;
+    int i;
+
+    for (i = 0; i < 400; ++i)
+    {
+        ones[i] = 1;
+        twos[i] = i ? 2 : 1;
+    }
+    x = cf_create_from_terms(ones, 400);
+    y = cf_create_from_terms(twos, 400);
+    c = cf_create_from_bihomo_pre(x, y, 0, 1, 0, 0, 0, 0, 1, 0, 512);
+
+    /* phi / sqrt(2) = 1.1441228056353685... = [1; 6, 1, 15, 3, ...] */
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == 6 );
+    c2 = cf_copy(c);
+    for (i = 0; i < 100; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    s1 = cf_convert_to_string_float(c, 40);
+    s2 = cf_convert_to_string_float(c2, 40);
+    ASSERT( strcmp(s1, s2) == 0 );
+    free(s1);
+    free(s2);
+
+    cf_free(x);
+    cf_free(y);
+    cf_free(c);
+    cf_free(c2);
+    return 0;
+}
+
+static int test_case_next_terms(void)
+{
+    long long buf[64];
+    size_t n, i;
+
+    {
+        cf *c = cf_create_from_terms_i(5, 2, 3, 4, 5, 6);
+
+        n = cf_next_terms(c, buf, 3);
+        ASSERT( n == 3 && buf[0] == 2 && buf[1] == 3 && buf[2] == 4 );
+        n = cf_next_terms(c, buf, 64);
+        ASSERT( n == 2 && buf[0] == 5 && buf[1] == 6 );
+        ASSERT( cf_is_finished(c) );
+        ASSERT( cf_next_terms(c, buf, 64) == 0 );
+
+        cf_free(c);
+    }
+
+    {
+        cf *c = cf_create_from_fraction((fraction){1920, 1080});
+
+        n = cf_next_terms(c, buf, 64);
+        ASSERT( n == 4 );
+        ASSERT( buf[0] == 1 && buf[1] == 1 && buf[2] == 3 && buf[3] == 2 );
+
+        cf_free(c);
+    }
+
+    /* batches through homographic and bihomographic over a gcf input */
+    {
+        cf *x = cf_create_from_sqrt_n(5);
+        cf *phi = cf_create_from_homographic(x, 1, 1, 0, 2);
+        cf *phi2 = cf_create_from_bihomographic(phi, phi, 1, 0, 0, 0,
+                                                0, 0, 0, 1);
+        cf *c = cf_copy(phi2);
+
+        n = cf_next_terms(phi, buf, 20);
+        ASSERT( n == 20 );
+        for (i = 0; i < n; ++i)
+        {
+            ASSERT( buf[i] == 1 );
+        }
+
+        n = cf_next_terms(phi2, buf, 10);
+        ASSERT( n == 10 );
+        for (i = 0; i < n; ++i)
+        {
+            ASSERT( buf[i] == cf_next_term(c) );
+        }
+
+        cf_free(x);
+        cf_free(phi);
+        cf_free(phi2);
+        cf_free(c);
+    }
+    return 0;
+}
+
+static int test_case_homographic_wide(void)
+{
+    /* (x * 10^18) / 10^18 == x needs more than 63 bits of coefficients */
+    const long long k = 1000000000000000000ll;
+    long long twos[300], big[6] = {0, k, 3, k, 7, 5};
+    cf * x, * y, * z, * c;
+    int i;
+
+    for (i = 0; i < 300; ++i)
+    {
+        twos[i] = i ? 2 : 1;
+    }
+    x = cf_create_from_terms(twos, 300);
+    y = cf_create_from_homographic(x, k, 0, 0, 1);
+    z = cf_create_from_homographic(y, 1, 0, 0, k);
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT( cf_next_term(z) == twos[i] );
+    }
+    ASSERT( cf_next_term(z) == LLONG_MAX );
+    ASSERT( cf_is_finished(z) );
+    cf_free(x);
+    cf_free(y);
+    cf_free(z);
+
+    /* huge input terms, and a copy taken in the wide state */
+    x = cf_create_from_terms(big, 6);
+    y = cf_create_from_homographic(x, 3, 1, 0, 3);
+    z = cf_create_from_homographic(y, 3, -1, 0, 3);
+    c = cf_copy(z);
+    for (i = 0; i < 6; ++i)
+    {
+        ASSERT( cf_next_term(z) == big[i] );
+        ASSERT( cf_next_term(c) == big[i] );
+    }
+    ASSERT( cf_is_finished(z) );
+    cf_free(x);
+    cf_free(y);
+    cf_free(z);
+    cf_free(c);
+    return 0;
+}
+
+static int test_case_bihomographic_adaptive(void)
+{
+    /* sqrt(3) / sqrt(13) = [0; 2, 12, 4, 12, 4, ...] */
+    {
+        cf * x = cf_create_from_sqrt_n(3);
+        cf * y = cf_create_from_sqrt_n(13);
+        cf * c = cf_create_from_bihomographic(x, y, 0, 1, 0, 0, 0, 0, 1, 0);
+        int i;
+
+        ASSERT( cf_next_term(c) == 0 );
+        ASSERT( cf_next_term(c) == 2 );
+        for (i = 0; i < 150; ++i)
+        {
+            ASSERT( cf_next_term(c) == 12 );
+            ASSERT( cf_next_term(c) == 4 );
+        }
+
+        cf_free(x);
+        cf_free(y);
+        cf_free(c);
+    }
+
+    /* same terms as the fixed precision engine, also from a copy */
+    {
+        long long ones[400], twos[400];
+        cf * x, * y, * c, * c2, * ref;
+        int i;
+
+        for (i = 0; i < 400; ++i)
+        {
+            ones[i] = 1;
+            twos[i] = i ? 2 : 1;
+        }
+        x = cf_create_from_terms(ones, 400);
+        y = cf_create_from_terms(twos, 400);
+        c = cf_create_from_bihomographic(x, y, 0, 1, 0, 0, 0, 0, 1, 0);
+        ref = cf_create_from_bihomo_pre(x, y, 0, 1, 0, 0, 0, 0, 1, 0, 1024);
+        for (i = 0; i < 50; ++i)
+        {
+            ASSERT( cf_next_term(c) == cf_next_term(ref) );
+        }
+        c2 = cf_copy(c);
+        for (i = 0; i < 100; ++i)
+        {
+            long long t = cf_next_term(ref);
+            ASSERT( cf_next_term(c) == t );
+            ASSERT( cf_next_term(c2) == t );
+        }
+
+        cf_free(x);
+        cf_free(y);
+        cf_free(c);
+        cf_free(c2);
+        cf_free(ref);
+    }
+
+    /* pi / pi still terminates under a limit of bits */
+    {
+        cf * pi = cf_create_from_pi();
+        cf * one = cf_create_from_bihomographic_bits(pi, pi,
+                                                     0, 1, 0, 0,
+                                                     0, 0, 1, 0, 256);
+        int i;
+
+        for (i = 0; i < 1000 && !cf_is_finished(one); ++i)
+        {
+            cf_next_term(one);
+        }
+        ASSERT( cf_is_finished(one) );
+
+        cf_free(pi);
+        cf_free(one);
+    }
+    return 0;
+}
+
+static int test_case_integer_small(void)
+{
+    integer_t a, b, c;
+
+    integer_init2_with_int64(a, 3000000000ll, 256);
+    integer_init2_with_int64(b, -7, 256);
+    integer_init2(c, 256);
+
+    /* 9 * 10^18 * ... grows out of int64 and comes back */
+    integer_mul(c, a, a);
+    integer_mul(c, c, a);
+    ASSERT( !c->is_small );
+    ASSERT( integer_get_int64(c) == LLONG_MAX );
+    integer_div(c, c, a);
+    ASSERT( c->is_small );
+    ASSERT( integer_get_int64(c) == 9000000000000000000ll );
+    integer_add(c, c, c);
+    ASSERT( !c->is_small && integer_sgn(c) > 0 );
+    integer_sub(c, c, c);
+    ASSERT( c->is_small && integer_is_zero(c) );
+
+    /* quotients are rounded towards -infinity as mpz_div() does */
+    integer_div(c, a, b);
+    ASSERT( integer_get_int64(c) == -428571429ll );
+    integer_div_int32(c, b, 2);
+    ASSERT( integer_get_int64(c) == -4 );
+    integer_diff(c, b, a);
+    ASSERT( integer_get_int64(c) == 3000000007ll );
+    ASSERT( integer_cmp(b, a) == -1 );
+
+    /* the precision still applies to small values */
+    integer_clear(c);
+    integer_init2_with_int64(c, 1ll << 40, 32);
+    ASSERT( integer_is_overflow(c) );
+
+    integer_clears(a, b, c, NULL);
+    return 0;
+}
+
+static int test_case_mpz_fraction(void)
+{
+    mpz_t n, d, a, b, q;
+    gmp_randstate_t rs;
+    long long buf[256];
+    size_t k, i;
+    fraction f;
+    cf * c, * c2;
+
+    mpz_inits(n, d, a, b, q, NULL);
+
+    /* same terms as in long long */
+    mpz_set_si(n, -1920);
+    mpz_set_si(d, 1081);
+    c = cf_create_from_mpz_fraction(n, d);
+    c2 = cf_create_from_fraction((fraction){-1920, 1081});
+    while (!cf_is_finished(c2))
+    {
+        ASSERT( !cf_is_finished(c) );
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    ASSERT( cf_is_finished(c) );
+    cf_free(c);
+    cf_free(c2);
+
+    /* a term out of long long ends the continued fraction */
+    mpz_ui_pow_ui(d, 2, 80);
+    mpz_add_ui(n, d, 1);
+    c = cf_create_from_mpz_fraction(n, d);
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == LLONG_MAX );
+    ASSERT( cf_is_finished(c) );
+    cf_free(c);
+
+    /* a 63-bit term still fits */
+    mpz_set_ui(n, 1);
+    mpz_set_str(d, "5000000000000000000", 10);
+    c = cf_create_from_mpz_fraction(n, d);
+    ASSERT( cf_next_term(c) == 0 );
+    ASSERT( cf_next_term(c) == 5000000000000000000ll );
+    ASSERT( cf_is_finished(c) );
+    cf_free(c);
+    c = cf_create_from_mpz_fraction(n, d);
+    f = rational_best_with_bound(c, LLONG_MAX, LLONG_MAX);
+    ASSERT( f.n == 1 && f.d == 5000000000000000000ll );
+    cf_free(c);
+
+    /* 40000 bits, against plain steps of Euclid */
+    gmp_randinit_default(rs);
+    gmp_randseed_ui(rs, 2026);
+    mpz_urandomb(n, rs, 40000);
+    mpz_urandomb(d, rs, 39990);
+    mpz_fdiv_qr(q, b, n, d);
+    mpz_set(a, d);
+    c = cf_create_from_mpz_fraction(n, d);
+    ASSERT( cf_next_term(c) == mpz_get_si(q) );
+    for (i = 0; i < 1000; ++i)
+    {
+        mpz_fdiv_qr(q, a, a, b);
+        mpz_swap(a, b);
+        ASSERT( cf_next_term(c) == mpz_get_si(q) );
+    }
+    c2 = cf_copy(c);
+    while ((k = cf_next_terms(c, buf, 256)) > 0)
+    {
+        for (i = 0; i < k; ++i)
+        {
+            ASSERT( mpz_sgn(b) != 0 );
+            mpz_fdiv_qr(q, a, a, b);
+            mpz_swap(a, b);
+            ASSERT( buf[i] == mpz_get_si(q) );
+            ASSERT( cf_next_term(c2) == buf[i] );
+        }
+    }
+    ASSERT( mpz_sgn(b) == 0 );
+    ASSERT( cf_is_finished(c2) );
+    cf_free(c);
+    cf_free(c2);
+
+    gmp_randclear(rs);
+    mpz_clears(n, d, a, b, q, NULL);
+    return 0;
+}
+
+static int test_case_sqrt_period(void)
+{
+    static const struct {
+        unsigned long long n;
+        size_t period;
+    } cases[] = {{2, 1}, {3, 2}, {7, 4}, {13, 5}, {94, 16}, {16, 0}};
+    long long buf[64];
+    size_t pre, period, i, k;
+    cf * c, * c2;
+    gcf * g;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        c = cf_create_from_sqrt_n(cases[i].n);
+        ASSERT( cf_get_period(c, &pre, &period) == 0 );
+        ASSERT( pre == 1 && period == cases[i].period );
+        cf_free(c);
+    }
+
+    /* sqrt(7) = [2; 1, 1, 1, 4] */
+    c = cf_create_from_sqrt_n(7);
+    ASSERT( cf_next_terms(c, buf, 9) == 9 );
+    ASSERT( buf[0] == 2 && buf[1] == 1 && buf[3] == 1 && buf[4] == 4 );
+    ASSERT( buf[5] == 1 && buf[8] == 4 );
+    cf_free(c);
+
+    /* a square is finite */
+    c = cf_create_from_sqrt_n(16);
+    ASSERT( cf_next_term(c) == 4 );
+    ASSERT( cf_is_finished(c) );
+    ASSERT( cf_next_term(c) == LLONG_MAX );
+    cf_free(c);
+
+    /* 2^64 - 1 = a^2 + 2a: [a; 1, 2a], beyond the precision of double */
+    c = cf_create_from_sqrt_n(ULLONG_MAX);
+    ASSERT( cf_next_term(c) == 0xffffffffll );
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == 0x1fffffffell );
+    ASSERT( cf_get_period(c, &pre, &period) == 0 && period == 2 );
+    cf_free(c);
+
+    /* same terms as the generalized continued fraction */
+    c = cf_create_from_sqrt_n(1000003);
+    g = gcf_create_from_sqrt_n(1000003);
+    c2 = cf_create_from_ghomo(g, 1, 0, 0, 1);
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    cf_free(c2);
+    cf_free(g);
+
+    /* the copy goes on from the same state */
+    c2 = cf_copy(c);
+    k = cf_next_terms(c, buf, 64);
+    ASSERT( k == 64 );
+    for (i = 0; i < k; ++i)
+    {
+        ASSERT( cf_next_term(c2) == buf[i] );
+    }
+    cf_free(c);
+    cf_free(c2);
+
+    /* not a periodic continued fraction */
+    c = cf_create_from_fraction((fraction){3, 7});
+    ASSERT( cf_get_period(c, &pre, &period) == -1 );
+    cf_free(c);
+    return 0;
+}
+
+static int test_case_quadratic(void)
+{
+    long long buf[64];
+    size_t pre, period, i;
+    cf * c, * c2, * root;
+
+    /* phi = (1 + sqrt(5)) / 2 = [1; 1, 1, ...] */
+    c = cf_create_from_quadratic(1, 1, 5, 2);
+    ASSERT( cf_next_terms(c, buf, 10) == 10 );
+    for (i = 0; i < 10; ++i)
+    {
+        ASSERT( buf[i] == 1 );
+    }
+    ASSERT( cf_get_period(c, &pre, &period) == 0 );
+    ASSERT( pre == 0 && period == 1 );
+    cf_free(c);
+
+    /* -sqrt(7) / 3 = [-1; 8, 2, 7, 2, 7, ...] */
+    c = cf_create_from_quadratic(0, -1, 7, 3);
+    ASSERT( cf_next_terms(c, buf, 7) == 7 );
+    ASSERT( buf[0] == -1 && buf[1] == 8 && buf[2] == 2 && buf[3] == 7 );
+    ASSERT( buf[4] == 2 && buf[5] == 7 && buf[6] == 2 );
+    ASSERT( cf_get_period(c, &pre, &period) == 0 );
+    ASSERT( pre == 2 && period == 2 );
+    cf_free(c);
+
+    /* rational values are finite */
+    c = cf_create_from_quadratic(3, 2, 16, 7);
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == 1 );
+    ASSERT( cf_next_term(c) == 3 );
+    ASSERT( cf_is_finished(c) );
+    ASSERT( cf_get_period(c, &pre, &period) == -1 );
+    cf_free(c);
+
+    /* same terms as the homographic function of sqrt(n) */
+    c = cf_create_from_quadratic(-12345, 678, 1000003, -991);
+    root = cf_create_from_sqrt_n(1000003);
+    c2 = cf_create_from_homographic(root, 678, -12345, 0, -991);
+    for (i = 0; i < 500; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    cf_free(c2);
+    cf_free(root);
+    ASSERT( cf_get_period(c, &pre, &period) == 0 );
+
+    /* the copy goes on from the same state */
+    c2 = cf_copy(c);
+    ASSERT( cf_next_terms(c, buf, 64) == 64 );
+    for (i = 0; i < 64; ++i)
+    {
+        ASSERT( cf_next_term(c2) == buf[i] );
+    }
+    cf_free(c);
+    cf_free(c2);
+
+    /* too large for the native integers, evaluated as a homographic */
+    c = cf_create_from_quadratic(1, LLONG_MAX, 3, 2);
+    root = cf_create_from_sqrt_n(3);
+    c2 = cf_create_from_homographic(root, LLONG_MAX, 1, 0, 2);
+    for (i = 0; i < 20; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    cf_free(c);
+    cf_free(c2);
+    cf_free(root);
+
+    /*
+     * sqrt(3 / 0): a zero denominator is not a quadratic, and cfr takes it
+     * as sqrt(3) / sqrt(0), which is infinite.
+     */
+    root = cf_create_from_sqrt_n(3);
+    c2 = cf_create_from_sqrt_n(0);
+    c = cf_create_from_bihomographic_bits(root, c2, 0, 1, 0, 0,
+                                          0, 0, 1, 0, 1024);
+    ASSERT( cf_next_term(c) == LLONG_MAX );
+    cf_free(c);
+    cf_free(c2);
+    cf_free(root);
+    return 0;
+}
+
+static int test_case_pi_chudnovsky(void)
+{
+    static const long long head[] = {3, 7, 15, 1, 292, 1, 1, 1, 2, 1, 3};
+    long long buf[256];
+    size_t i, k, n = 0;
+    cf * c, * c2;
+    gcf * g;
+
+    c = cf_create_from_pi();
+    for (i = 0; i < sizeof(head) / sizeof(head[0]); ++i)
+    {
+        ASSERT( cf_next_term(c) == head[i] );
+    }
+    cf_free(c);
+
+    /* same terms as the generalized continued fraction of arctan(1) */
+    c = cf_create_from_pi();
+    g = gcf_create_from_pi();
+    c2 = cf_create_from_ghomo(g, 1, 0, 0, 1);
+    cf_free(g);
+    while (n < 3000)
+    {
+        k = cf_next_terms(c, buf, 256);
+        ASSERT( k == 256 );
+        for (i = 0; i < k; ++i)
+        {
+            ASSERT( cf_next_term(c2) == buf[i] );
+        }
+        n += k;
+    }
+
+    /* the copy goes on from the same term, across refills */
+    cf_free(c2);
+    c2 = cf_copy(c);
+    for (i = 0; i < 2000; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+
+    /* terms reserved at once are the same */
+    cf_reserve_terms(c2, 5000);
+    for (i = 0; i < 5000; ++i)
+    {
+        ASSERT( cf_next_term(c) == cf_next_term(c2) );
+    }
+    cf_free(c);
+    cf_free(c2);
+    return 0;
+}
+
+static int test_case_digit_chunks(void)
+{
+    static const fraction values[] = {
+        {1, 2}, {-1, 2}, {1, 3}, {-7, 3}, {123456789, 1000}, {-1, 400},
+        {355, 113}, {22, 7}, {1, 1048576}, {0, 5}, {5, 1}
+    };
+    char digits[200];
+    size_t i, k, n;
+    cf * c;
+    cf_digit_gen * g, * g2;
+
+    /* chunks have the digits retrieved one by one */
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        for (n = 1; n < 60; n += 7)
+        {
+            c = cf_create_from_fraction(values[i]);
+            g = cf_digit_gen_create_dec(c);
+            g2 = cf_digit_gen_create_dec(c);
+            ASSERT( cf_next_term(g) == cf_next_term(g2) );
+            k = cf_digit_gen_next_digits(g, digits, n);
+            ASSERT( k <= n );
+            for (k = 0; k < n && !cf_is_finished(g2); ++k)
+            {
+                ASSERT( digits[k] == '0' + cf_next_term(g2) );
+            }
+            ASSERT( cf_digit_gen_next_digits(g, digits, 0) == 0 );
+            ASSERT( cf_is_finished(g) == cf_is_finished(g2) );
+            cf_free(g);
+            cf_free(g2);
+            cf_free(c);
+        }
+    }
+
+    c = cf_create_from_fraction((fraction){1, 1048576});
+    g = cf_digit_gen_create_dec(c);
+    ASSERT( cf_next_term(g) == 0 );
+    k = cf_digit_gen_next_digits(g, digits, 100);
+    digits[k] = '\0';
+    ASSERT( strcmp(digits, "00000095367431640625") == 0 );
+    ASSERT( cf_is_finished(g) );
+    cf_free(g);
+    cf_free(c);
+
+    /* an infinite value has no digits */
+    c = cf_create_from_fraction((fraction){1, 0});
+    g = cf_digit_gen_create_dec(c);
+    ASSERT( cf_digit_gen_next_digits(g, digits, 10) == 0 );
+    ASSERT( cf_is_finished(g) );
+    cf_free(g);
+    cf_free(c);
+
+    {
+        char * s;
+        c = cf_create_from_fraction((fraction){-1, 400});
+        s = cf_convert_to_string_float(c, 30);
+        ASSERT( strcmp(s, "-0.0025") == 0 );
+        free(s);
+        cf_free(c);
+
+        c = cf_create_from_fraction((fraction){1000, 7});
+        s = cf_convert_to_string_float(c, 2);
+        ASSERT( strcmp(s, "142...." ) == 0 );
+        free(s);
+        s = cf_convert_to_string_float(c, 40);
+        ASSERT( strcmp(s, "142.85714285714285714285714285714285714285..." ) == 0 );
+        free(s);
+        cf_free(c);
+    }
+    return 0;
+}
+
+static int test_case_string_float_bulk(void)
+{
+    static const fraction values[] = {
+        {1, 2}, {-1, 2}, {1, 3}, {-7, 3}, {123456789, 1000}, {-1, 400},
+        {355, 113}, {1000, 7}, {1, 1048576}, {0, 5}, {5, 1}, {-5, 1}
+    };
+    static const int digits[] = {1, 2, 3, 10, 25, 100};
+    size_t i, j;
+    cf * c;
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        c = cf_create_from_fraction(values[i]);
+        for (j = 0; j < sizeof(digits) / sizeof(digits[0]); ++j)
+        {
+            char * s1 = cf_convert_to_string_float(c, digits[j]);
+            char * s2 = cf_convert_to_string_float_bulk(c, digits[j]);
+            ASSERT( strcmp(s1, s2) == 0 );
+            free(s1);
+            free(s2);
+        }
+        cf_free(c);
+    }
+
+    {
+        cf * list[5];
+        list[0] = cf_create_from_pi();
+        list[1] = cf_create_from_sqrt_n(2);
+        list[2] = cf_create_from_quadratic(-12345, 678, 1000003, -991);
+        list[3] = cf_create_from_homographic(list[0], -3, 1, 0, 7);
+        /* not canonical */
+        list[4] = cf_create_from_terms_i(4, 1, -2, 3, 5);
+        for (i = 0; i < 5; ++i)
+        {
+            for (j = 0; j < sizeof(digits) / sizeof(digits[0]); ++j)
+            {
+                char * s1 = cf_convert_to_string_float(list[i], digits[j] * 20);
+                char * s2 = cf_convert_to_string_float_bulk(list[i], digits[j] * 20);
+                ASSERT( strcmp(s1, s2) == 0 );
+                free(s1);
+                free(s2);
+            }
+        }
+        for (i = 0; i < 5; ++i)
+        {
+            cf_free(list[i]);
+        }
+    }
+
+    /* terms in many chunks: the digits of sqrt(2) are those of mpz_sqrt() */
+    c = cf_create_from_sqrt_n(2);
+    {
+        char * s = cf_convert_to_string_float_bulk(c, 150000);
+        char * s2 = (char*)malloc(150003);
+        mpz_t z;
+
+        mpz_init(z);
+        mpz_ui_pow_ui(z, 10u, 2 * 150000);
+        mpz_mul_ui(z, z, 2u);
+        mpz_sqrt(z, z);
+        mpz_get_str(s2 + 1, 10, z);
+        s2[0] = s2[1];
+        s2[1] = '.';
+        ASSERT( strlen(s) == 150005 && memcmp(s, s2, 150002) == 0 );
+        ASSERT( strcmp(s + 150002, "...") == 0 );
+        mpz_clear(z);
+        free(s);
+        free(s2);
+    }
+    cf_free(c);
+
+    c = cf_create_from_pi();
+    {
+        char * s = cf_convert_to_string_float_bulk(c, 0);
+        ASSERT( strcmp(s, "NAN") == 0 );
+        free(s);
+    }
+    cf_free(c);
+    return 0;
+}
+
+/* a sink collecting the output, failing after `fail_after' blocks */
+typedef struct _test_sink test_sink;
+struct _test_sink {
+    char * s;
+    size_t len;
+    size_t blocks, fail_after;
+};
+
+static int test_sink_put(const char *buf, size_t len, void *data)
+{
+    test_sink * ts = (test_sink*) data;
+    char * s;
+
+    if (ts->blocks++ >= ts->fail_after)
+        return -1;
+    s = (char*)realloc(ts->s, ts->len + len + 1);
+    if (!s)
+        return -1;
+    memcpy(s + ts->len, buf, len);
+    ts->s = s;
+    ts->len += len;
+    ts->s[ts->len] = '\0';
+    return 0;
+}
+
+static int test_case_write_float(void)
+{
+    static const int digits[] = {1, 3, 25, 100, 5000, 40000};
+    cf * list[5];
+    size_t i, j;
+
+    list[0] = cf_create_from_pi();
+    list[1] = cf_create_from_sqrt_n(2);
+    list[2] = cf_create_from_fraction((fraction){-1000, 7});
+    list[3] = cf_create_from_fraction((fraction){1, 1048576});
+    /* not canonical */
+    list[4] = cf_create_from_terms_i(4, 1, -2, 3, 5);
+    for (i = 0; i < 5; ++i)
+    {
+        for (j = 0; j < sizeof(digits) / sizeof(digits[0]); ++j)
+        {
+            test_sink ts = {NULL, 0, 0, (size_t)-1};
+            char * s = cf_convert_to_string_float(list[i], digits[j]);
+
+            ASSERT( cf_write_float_to(test_sink_put, &ts, list[i], digits[j]) == 0 );
+            ASSERT( strcmp(s, ts.s) == 0 );
+            /* blocks of 4096 bytes */
+            ASSERT( ts.blocks == (ts.len + 4095) / 4096 );
+            free(s);
+            free(ts.s);
+        }
+    }
+
+    /* a failure of the sink stops the output */
+    {
+        test_sink ts = {NULL, 0, 0, 2};
+        ASSERT( cf_write_float_to(test_sink_put, &ts, list[0], 20000) == -1 );
+        ASSERT( ts.len == 2 * 4096 );
+        ASSERT( ts.blocks == 3 );
+        free(ts.s);
+    }
+
+    for (i = 0; i < 5; ++i)
+    {
+        cf_free(list[i]);
+    }
+    return 0;
+}
+
+static int test_case_term_file(void)
+{
+    char path[] = "/tmp/testcf_XXXXXX";
+    long long t1[256], t2[256], after;
+    cf * list[4];
+    size_t i;
+    int fd;
+
+    fd = mkstemp(path);
+    ASSERT( fd >= 0 );
+    close(fd);
+
+    list[0] = cf_create_from_pi();
+    list[1] = cf_create_from_sqrt_n(2);
+    list[2] = cf_create_from_terms_ll(5, -7ll, 1ll, 300ll, 1ll << 40, LLONG_MAX - 1);
+    list[3] = cf_create_from_terms_i(1, 0);
+    for (i = 0; i < 4; ++i)
+    {
+        size_t max_terms = i == 1 ? 100 : 20000;
+        int is_complete = -1;
+        FILE * f = fopen(path, "wb");
+        cf * c, * c2, * x;
+
+        ASSERT( f );
+        ASSERT( cf_write_binary(f, list[i], max_terms) == 0 );
+        fclose(f);
+        c = cf_create_from_file(path, &is_complete);
+        ASSERT( c );
+        ASSERT( is_complete == (i >= 2) );
+
+        x = cf_copy(list[i]);
+        c2 = NULL;
+        after = LLONG_MAX;
+        while (!cf_is_finished(c))
+        {
+            size_t n1 = cf_next_terms(c, t1, 100);
+            size_t n2 = cf_next_terms(x, t2, n1);
+            ASSERT( n1 == n2 && memcmp(t1, t2, n1 * sizeof(long long)) == 0 );
+            if (c2 && after == LLONG_MAX)
+                after = t1[0];
+            if (!c2)
+                c2 = cf_copy(c);
+        }
+        /* a copy goes on from where it is, on the same mapping */
+        if (i == 0)
+        {
+            ASSERT( cf_next_term(c2) == after );
+        }
+        ASSERT( cf_next_term(c) == LLONG_MAX );
+        cf_free(c2);
+        cf_free(x);
+        cf_free(c);
+    }
+
+    /* not canonical */
+    {
+        cf * c = cf_create_from_terms_i(3, 1, -2, 3);
+        FILE * f = fopen(path, "wb");
+        ASSERT( cf_write_binary(f, c, 10) == -1 );
+        fclose(f);
+        cf_free(c);
+    }
+    /* not a term file */
+    {
+        FILE * f = fopen(path, "wb");
+        fputs("[1; 2, 3]", f);
+        fclose(f);
+        ASSERT( cf_create_from_file(path, NULL) == NULL );
+        ASSERT( cf_create_from_file("/nonexistent/cf", NULL) == NULL );
+    }
+
+    /* the canonical string to a file */
+    {
+        FILE * f = fopen(path, "w+");
+        char buf[64];
+        char * s = cf_convert_to_string_canonical(list[2], 3);
+        ASSERT( cf_write_canonical(f, list[2], 3) == 0 );
+        rewind(f);
+        ASSERT( fgets(buf, sizeof(buf), f) );
+        ASSERT( strcmp(buf, s) == 0 );
+        ASSERT( strcmp(buf, "[-7; 1, 300, ...]") == 0 );
+        fclose(f);
+        free(s);
+    }
+
+    for (i = 0; i < 4; ++i)
+    {
+        cf_free(list[i]);
+    }
+    remove(path);
+    return 0;
+}
+
+static int test_case_terms_shared(void)
+{
+    static const long long terms[] = {3, 7, 15, 1, 292, 1, 1, 1, 2, 1};
+    char path[] = "/tmp/testcf_XXXXXX";
+    long long * owned;
+    cf * c, * c1, * c2;
+    size_t i;
+    int fd;
+
+    /* copies share the array and go on from their own positions */
+    c = cf_create_from_terms_borrowed(terms, 10);
+    ASSERT( cf_next_term(c) == 3 );
+    c1 = cf_copy(c);
+    ASSERT( cf_next_term(c) == 7 );
+    c2 = cf_copy(c);
+    cf_free(c);
+    for (i = 1; i < 10; ++i)
+    {
+        ASSERT( cf_next_term(c1) == terms[i] );
+    }
+    ASSERT( cf_is_finished(c1) );
+    ASSERT( cf_next_term(c2) == 15 );
+    cf_free(c1);
+    cf_free(c2);
+    ASSERT( cf_create_from_terms_borrowed(terms, 0) == NULL );
+
+    owned = (long long*)malloc(sizeof(terms));
+    memcpy(owned, terms, sizeof(terms));
+    c = cf_create_from_terms_owned(owned, 10);
+    c1 = cf_copy(c);
+    cf_free(c);
+    {
+        char * s = cf_convert_to_string_canonical(c1, 20);
+        ASSERT( strcmp(s, "[3; 7, 15, 1, 292, 1, 1, 1, 2, 1]") == 0 );
+        free(s);
+    }
+    cf_free(c1);
+
+    /* a file of raw terms */
+    fd = mkstemp(path);
+    ASSERT( fd >= 0 );
+    ASSERT( write(fd, terms, sizeof(terms)) == (ssize_t)sizeof(terms) );
+    close(fd);
+    c = cf_create_from_terms_file(path);
+    ASSERT( c );
+    c1 = cf_copy(c);
+    for (i = 0; i < 10; ++i)
+    {
+        ASSERT( cf_next_term(c) == terms[i] );
+    }
+    ASSERT( cf_next_term(c) == LLONG_MAX );
+    cf_free(c);
+    ASSERT( cf_next_term(c1) == 3 );
+    cf_free(c1);
+    fd = open(path, O_WRONLY | O_APPEND);
+    ASSERT( write(fd, "x", 1) == 1 );
+    close(fd);
+    ASSERT( cf_create_from_terms_file(path) == NULL );
+    remove(path);
+    return 0;
+}
+
+static int test_case_shared_copies(void)
+{
+    cf * x = cf_create_from_sqrt_n(2);
+    cf * c, * c1, * c2;
+    char * s;
+    int i;
+
+    /* a deep chain of x + 1, each level built on a copy of the last */
+    for (i = 0; i < 2000; ++i)
+    {
+        cf * y = cf_create_from_homographic(x, 1, 1, 0, 1);
+        cf_free(x);
+        x = y;
+    }
+    s = cf_convert_to_string_canonical(x, 5);
+    ASSERT( strcmp(s, "[2001; 2, 2, 2, 2, ...]") == 0 );
+    free(s);
+    cf_free(x);
+
+    /* copies read the same terms in any order, and outlive the original */
+    x = cf_create_from_pi();
+    c = cf_create_from_bihomographic(x, x, 1, 0, 0, 1, 0, 0, 0, 1);
+    cf_free(x);
+    ASSERT( cf_next_term(c) == 10 );
+    c1 = cf_copy(c);
+    for (i = 0; i < 100; ++i)
+    {
+        ASSERT( cf_next_term(c1) == cf_next_term(c) );
+        if (i % 7 == 3)
+        {
+            c2 = cf_copy(c1);
+            cf_free(c1);
+            c1 = c2;
+        }
+        if (i % 11 == 5)
+        {
+            cf_free(c1);
+            c1 = cf_copy(c);
+        }
+    }
+    cf_free(c);
+    s = cf_convert_to_string_canonical(c1, 3);
+    ASSERT( s && s[0] == '[' );
+    free(s);
+    cf_free(c1);
+
+    x = cf_create_from_terms_i(3, 1, 2, 3);
+    c = cf_create_from_homographic(x, 2, 0, 0, 1);
+    c1 = cf_copy(c);
+    c2 = cf_copy(c1);
+    cf_free(c);
+    s = cf_convert_to_string_canonical(c1, 10);
+    ASSERT( strcmp(s, "[2; 1, 6]") == 0 );
+    free(s);
+    ASSERT( cf_next_term(c2) == 2 );
+    ASSERT( !cf_is_finished(c2) );
+    cf_free(c1);
+    cf_free(c2);
+    cf_free(x);
+    return 0;
+}
+
+/* [1; 1, 1, ...] counting the terms worked out by it and its copies */
+typedef struct _counted counted;
+struct _counted {
+    cf base;
+    size_t * count;
+};
+
+static long long counted_next_term(cf *c)
+{
+    ++*((counted*)c)->count;
+    return 1;
+}
+
+static int counted_is_finished(const cf *c)
+{
+    (void)c;
+    return 0;
+}
+
+static void counted_free(cf *c)
+{
+    free(c);
+}
+
+static cf * counted_copy(const cf *c)
+{
+    counted * copy = (counted*)malloc(sizeof(counted));
+    *copy = *(const counted*)c;
+    return &copy->base;
+}
+
+static cf_class _counted_class = {
+    counted_next_term,
+    counted_is_finished,
+    counted_free,
+    counted_copy,
+    NULL
+};
+
+static int test_case_memo(void)
+{
+    size_t count = 0, plain;
+    counted x = {{&_counted_class}, &count};
+    cf * m, * e, * e2;
+    char * s1, * s2;
+
+    /* x * x + x = phi^2 + phi = phi^3 = 2 + sqrt(5) */
+    e = cf_create_from_bihomographic(&x.base, &x.base, 1, 1, 0, 0, 0, 0, 0, 1);
+    s1 = cf_convert_to_string_canonical(e, 30);
+    plain = count;
+    cf_free(e);
+
+    count = 0;
+    m = cf_create_memo(&x.base);
+    e = cf_create_from_bihomographic(m, m, 1, 1, 0, 0, 0, 0, 0, 1);
+    s2 = cf_convert_to_string_canonical(e, 30);
+    ASSERT( strcmp(s1, s2) == 0 );
+    ASSERT( strncmp(s1, "[4; 4, 4, 4,", 12) == 0 );
+    /* the copies of the memo share the terms */
+    ASSERT( count * 2 <= plain + 2 );
+
+    /* the memo itself replays the terms its forks have worked out */
+    count = 0;
+    ASSERT( cf_next_term(m) == 1 && cf_next_term(m) == 1 );
+    ASSERT( count == 0 );
+    cf_free(m);
+    cf_free(e);
+
+    /* forks replay the terms of the others, and go on by themselves */
+    m = cf_create_memo(&x.base);
+    e2 = cf_copy(m);
+    ASSERT( cf_next_term(m) == 1 && cf_next_term(m) == 1 );
+    ASSERT( count == 2 );
+    ASSERT( cf_next_term(e2) == 1 && cf_next_term(e2) == 1 );
+    ASSERT( cf_next_term(e2) == 1 );
+    ASSERT( count == 3 );
+    cf_free(m);
+    ASSERT( cf_next_term(e2) == 1 );
+    ASSERT( count == 4 );
+    cf_free(e2);
+
+    free(s1);
+    free(s2);
+    return 0;
+}
+
+static int test_case_digit_gen_copy(void)
+{
+    cf * c = cf_create_from_pi();
+    cf_digit_gen * g = cf_digit_gen_create_dec(c);
+    cf_digit_gen * g2;
+    char d1[64], d2[64];
+    int i;
+
+    ASSERT( cf_next_term(g) == 3 );
+    for (i = 0; i < 5; ++i)
+    {
+        cf_next_term(g);
+    }
+
+    /* the copy goes on after the digits retrieved: 3.14159 26535 ... */
+    g2 = cf_copy(g);
+    ASSERT( cf_next_term(g2) == 2 );
+    ASSERT( cf_digit_gen_next_digits(g2, d2, 10) == 10 );
+    ASSERT( memcmp(d2, "6535897932", 10) == 0 );
+    ASSERT( !cf_class(g2)->is_negative(g2) );
+
+    /* peeking leaves the digits to be retrieved */
+    ASSERT( cf_digit_gen_peek_digits(g, d1, 20) == 20 );
+    ASSERT( memcmp(d1, "26535897932384626433", 20) == 0 );
+    ASSERT( cf_digit_gen_peek_digits(g, d2, 3) == 3 );
+    ASSERT( memcmp(d2, "265", 3) == 0 );
+    ASSERT( cf_digit_gen_next_digits(g, d2, 20) == 20 );
+    ASSERT( memcmp(d1, d2, 20) == 0 );
+    cf_free(g);
+    cf_free(g2);
+    cf_free(c);
+
+    /* a value that ends */
+    c = cf_create_from_fraction((fraction){-1, 8});
+    g = cf_digit_gen_create_dec(c);
+    cf_next_term(g);
+    ASSERT( cf_digit_gen_peek_digits(g, d1, 10) == 3 );
+    ASSERT( memcmp(d1, "125", 3) == 0 );
+    g2 = cf_copy(g);
+    ASSERT( cf_class(g2)->is_negative(g2) );
+    ASSERT( cf_digit_gen_next_digits(g2, d2, 10) == 3 );
+    ASSERT( cf_is_finished(g2) && !cf_is_finished(g) );
+
+    /* a finished generator, and an infinite value, have nothing to peek */
+    ASSERT( cf_digit_gen_peek_digits(g2, d1, 10) == 0 );
+    cf_free(g);
+    cf_free(g2);
+    cf_free(c);
+    c = cf_create_from_fraction((fraction){1, 0});
+    g = cf_digit_gen_create_dec(c);
+    ASSERT( cf_digit_gen_peek_digits(g, d1, 10) == 0 );
+    cf_free(g);
+    cf_free(c);
+    return 0;
+}
+
+static int test_case_converg_mpz(void)
+{
+    static const long long pi_p[] = {3, 22, 333, 355, 103993};
+    static const long long pi_q[] = {1, 7, 106, 113, 33102};
+    cf * c = cf_create_from_pi();
+    cf_converg_mpz_gen * g = cf_converg_mpz_gen_create(c);
+    cf_converg_mpz_gen * g2;
+    const cf_converg_mpz_term * t;
+    mpz_t lower, upper, v;
+    int i;
+
+    mpz_inits(lower, upper, v, NULL);
+    for (i = 0; i < 5; ++i)
+    {
+        t = cf_next_term(g);
+        ASSERT( t && !t->exact );
+        ASSERT( mpz_cmp_si(t->p, pi_p[i]) == 0 && mpz_cmp_si(t->q, pi_q[i]) == 0 );
+        if (i == 1)
+        {
+            /* 1/791 < |pi - 22/7| < 1/742 */
+            ASSERT( t->coef == 7 );
+            cf_converg_mpz_term_errors(t, lower, upper);
+            ASSERT( mpz_cmp_ui(lower, 791u) == 0 && mpz_cmp_ui(upper, 742u) == 0 );
+        }
+    }
+
+    /* a copy goes on from the generator */
+    g2 = cf_copy(g);
+    t = cf_next_term(g);
+    mpz_set(v, t->q);
+    t = cf_next_term(g2);
+    ASSERT( mpz_cmp(v, t->q) == 0 && mpz_cmp_ui(v, 33215u) == 0 );
+    cf_free(g2);
+    cf_free(g);
+    cf_free(c);
+
+    /* far beyond long long: p^2 - 2 q^2 = +-1 for convergents of sqrt(2) */
+    c = cf_create_from_sqrt_n(2);
+    g = cf_converg_mpz_gen_create(c);
+    for (i = 0; i < 20000; ++i)
+    {
+        t = cf_next_term(g);
+    }
+    ASSERT( mpz_sizeinbase(t->q, 2) > 25000 );
+    mpz_mul(v, t->p, t->p);
+    mpz_mul(lower, t->q, t->q);
+    mpz_mul_2exp(lower, lower, 1);
+    mpz_sub(v, v, lower);
+    ASSERT( mpz_cmpabs_ui(v, 1u) == 0 );
+    cf_free(g);
+    cf_free(c);
+
+    /* a rational ends exactly */
+    c = cf_create_from_fraction((fraction){-16, 9});
+    g = cf_converg_mpz_gen_create(c);
+    for (i = 0; !cf_is_finished(g); ++i)
+    {
+        t = cf_next_term(g);
+    }
+    ASSERT( i == 3 && t->exact );
+    ASSERT( mpz_cmp_si(t->p, -16) == 0 && mpz_cmp_si(t->q, 9) == 0 );
+    cf_converg_mpz_term_errors(t, lower, upper);
+    ASSERT( mpz_sgn(lower) == 0 && mpz_sgn(upper) == 0 );
+    ASSERT( cf_next_term(g) == NULL );
+    cf_free(g);
+    cf_free(c);
+
+    mpz_clears(lower, upper, v, NULL);
+    return 0;
+}
+
+static int test_case_convergent_at(void)
+{
+    cf * c = cf_create_from_pi();
+    cf_converg_mpz_gen * g;
+    const cf_converg_mpz_term * t = NULL;
+    mpz_t p, q, p2, q2;
+    int i;
+
+    mpz_inits(p, q, p2, q2, NULL);
+    ASSERT( cf_convergent_at(c, 0, p, q) == 0 );
+    ASSERT( mpz_cmp_ui(p, 3u) == 0 && mpz_cmp_ui(q, 1u) == 0 );
+    ASSERT( cf_convergent_at(c, 4, p, q) == 0 );
+    ASSERT( mpz_cmp_ui(p, 103993u) == 0 && mpz_cmp_ui(q, 33102u) == 0 );
+    cf_free(c);
+
+    /* the same as the generator, on one thread and on several */
+    c = cf_create_from_sqrt_n(7);
+    g = cf_converg_mpz_gen_create(c);
+    for (i = 0; i <= 30000; ++i)
+    {
+        t = cf_next_term(g);
+    }
+    ASSERT( cf_convergent_at(c, 30000, p, q) == 0 );
+    ASSERT( mpz_cmp(p, t->p) == 0 && mpz_cmp(q, t->q) == 0 );
+    ASSERT( cf_convergent_at_threads(c, 30000, p2, q2, 5) == 0 );
+    ASSERT( mpz_cmp(p2, p) == 0 && mpz_cmp(q2, q) == 0 );
+    cf_free(g);
+    cf_free(c);
+
+    /* a rational ends before the index */
+    c = cf_create_from_fraction((fraction){-16, 9});
+    ASSERT( cf_convergent_at(c, 10, p, q) == 1 );
+    ASSERT( mpz_cmp_si(p, -16) == 0 && mpz_cmp_si(q, 9) == 0 );
+    cf_free(c);
+
+    /* even far before, with no buffer of k terms */
+    c = cf_create_from_fraction((fraction){1, 3});
+    ASSERT( cf_convergent_at(c, (size_t)100000000000ull, p, q) == 1 );
+    ASSERT( mpz_cmp_ui(p, 1u) == 0 && mpz_cmp_ui(q, 3u) == 0 );
+    ASSERT( cf_convergent_at(c, 1, p, q) == 0 );
+    ASSERT( mpz_cmp_ui(p, 1u) == 0 && mpz_cmp_ui(q, 3u) == 0 );
+    cf_free(c);
+
+    mpz_clears(p, q, p2, q2, NULL);
+    return 0;
+}
+
+static int test_case_convergents_scan(void)
+{
+    static const size_t sizes[] = {1, 2, 3, 1500, 5000};
+    long long * terms = (long long*)malloc(5000 * sizeof(long long));
+    cf * c = cf_create_from_pi();
+    cf_converg_mpz_gen * g;
+    const cf_converg_mpz_term * t;
+    mpz_t p[5000], q[5000];
+    size_t i, k;
+    int threads;
+
+    ASSERT( cf_next_terms(c, terms, 5000) == 5000 );
+    cf_free(c);
+    for (i = 0; i < 5000; ++i)
+    {
+        mpz_inits(p[i], q[i], NULL);
+    }
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+    {
+        for (threads = 1; threads <= 4; threads += 3)
+        {
+            ASSERT( cf_convergents_scan(terms, sizes[k], p, q, threads) == 0 );
+            c = cf_create_from_terms_borrowed(terms, sizes[k]);
+            g = cf_converg_mpz_gen_create(c);
+            for (i = 0; i < sizes[k]; ++i)
+            {
+                t = cf_next_term(g);
+                ASSERT( mpz_cmp(p[i], t->p) == 0 && mpz_cmp(q[i], t->q) == 0 );
+            }
+            cf_free(g);
+            cf_free(c);
+        }
+    }
+
+    /* terms far beyond long long products: p_k q_{k-1} - p_{k-1} q_k = (-1)^{k+1} */
+    for (i = 0; i < 3000; ++i)
+    {
+        terms[i] = i % 3 ? (long long)i : LLONG_MAX / 3;
+    }
+    ASSERT( cf_convergents_scan(terms, 3000, p, q, 2) == 0 );
+    mpz_mul(p[0], p[2999], q[2998]);
+    mpz_submul(p[0], p[2998], q[2999]);
+    ASSERT( mpz_cmp_ui(p[0], 1u) == 0 );
+
+    for (i = 0; i < 5000; ++i)
+    {
+        mpz_clears(p[i], q[i], NULL);
+    }
+    free(terms);
+    return 0;
+}
+
+/*
+ * The best fraction of n / d by trying all denominators, the closest
+ * one, the smallest denominator of the closest, and the smallest
+ * |numerator| of those.
+ */
+static fraction best_bound_brute(long long n, long long d,
+                                 long long maxden, long long maxnum)
+{
+    fraction best = {0, 0};
+    long long q;
+
+    for (q = 1; q <= maxden; ++q)
+    {
+        /* the numerators around n q / d, and the bounds */
+        long long p0 = (n * q - (n * q % d + d) % d) / d;
+        long long ps[4] = {p0, p0 + 1, maxnum, -maxnum};
+        int i, np = maxnum < 100000 ? 4 : 2;
+
+        for (i = 0; i < np; ++i)
+        {
+            long long p = ps[i], e, eb;
+
+            if (p > maxnum || -p > maxnum)
+                continue;
+            /* |n / d - p / q| compared as |n q - p d| / q */
+            e = n * q - p * d;
+            e = e < 0 ? -e : e;
+            eb = n * best.d - best.n * d;
+            eb = eb < 0 ? -eb : eb;
+            if (best.d == 0 || e * best.d < eb * q ||
+                (e * best.d == eb * q && q == best.d &&
+                 (p < 0 ? -p : p) < (best.n < 0 ? -best.n : best.n)))
+                best = (fraction){p, q};
+        }
+    }
+    return best;
+}
+
+static int test_case_best_with_bound(void)
+{
+    unsigned long long seed = 12345;
+    cf * c;
+    fraction f;
+    int i;
+
+    /* 179/57 is a semiconvergent of pi, closer than 22/7 */
+    c = cf_create_from_pi();
+    f = rational_best_with_bound(c, 57, LLONG_MAX);
+    ASSERT( f.n == 179 && f.d == 57 );
+    f = rational_best_with_bound(c, 56, LLONG_MAX);
+    ASSERT( f.n == 22 && f.d == 7 );
+    f = rational_best_with_bound(c, 16000, LLONG_MAX);
+    ASSERT( f.n == 355 && f.d == 113 );
+    f = rational_best_with_bound(c, 1000, 100);
+    ASSERT( f.n == 22 && f.d == 7 );
+    f = rational_best_with_bound(c, LLONG_MAX, 2);
+    ASSERT( f.n == 2 && f.d == 1 );
+    cf_free(c);
+
+    /* ties are decided alike for x and -x: k + 1/2 gives k */
+    for (i = -4; i <= 4; ++i)
+    {
+        long long k = i < 0 ? -i : i;
+
+        c = cf_create_from_fraction((fraction){2 * i + (i < 0 ? -1 : 1), 2});
+        f = rational_best_with_bound(c, 1, LLONG_MAX);
+        ASSERT( f.n == (i < 0 ? -k : k) && f.d == 1 );
+        cf_free(c);
+    }
+    c = cf_create_from_fraction((fraction){-3, 4});
+    f = rational_best_with_bound(c, 2, LLONG_MAX);
+    ASSERT( f.n == -1 && f.d == 1 );
+    cf_free(c);
+
+    /* terms of an engine that are not canonical: 1 / -2.5 = [0; -2, -2] */
+    {
+        cf * x = cf_create_from_fraction((fraction){-5, 2});
+        c = cf_create_from_homographic(x, 0, 1, 1, 0);
+        f = rational_best_with_bound(c, LLONG_MAX, LLONG_MAX);
+        ASSERT( f.n == -2 && f.d == 5 );
+        f = rational_best_with_bound(c, 3, LLONG_MAX);
+        ASSERT( f.n == -1 && f.d == 3 );
+        cf_free(c);
+        cf_free(x);
+        x = cf_create_from_fraction((fraction){-314159, 100000});
+        c = cf_create_from_homographic(x, 0, 1, 1, 0);
+        f = rational_best_with_bound(c, 1000, LLONG_MAX);
+        ASSERT( f.n == -113 && f.d == 355 );
+        cf_free(c);
+        cf_free(x);
+    }
+
+    for (i = 0; i < 3000; ++i)
+    {
+        long long n, d, maxden, maxnum;
+        fraction g;
+
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        /* small denominators for ties */
+        d = (long long)(seed >> 40) % (i % 2 ? 5000 : 12) + 1;
+        n = (long long)(seed >> 20) % 20000 - 10000;
+        maxden = (long long)(seed >> 8) % 60 + 1;
+        maxnum = i % 3 ? LLONG_MAX / 2 : (long long)(seed >> 30) % 50;
+        c = cf_create_from_fraction((fraction){n, d});
+        f = rational_best_with_bound(c, maxden, maxnum);
+        g = best_bound_brute(n, d, maxden, maxnum);
+        cf_free(c);
+        if (f.n != g.n || f.d != g.d)
+            printf("  %lld/%lld maxden %lld maxnum %lld: %lld/%lld, not %lld/%lld\n",
+                   n, d, maxden, maxnum, f.n, f.d, g.n, g.d);
+        ASSERT( f.n == g.n && f.d == g.d );
+    }
+    return 0;
+}
+
+static int test_case_best_batch(void)
+{
+    static const double in[] = {3.141592653589793, -0.75, 0.0, 1e300, 1e-30,
+                                INFINITY, -INFINITY, NAN, 42.0, -2.5, 0.01};
+    static const fraction want[] = {{179, 57}, {-3, 4}, {0, 1},
+                                    {LLONG_MAX, 1}, {0, 1}, {1, 0}, {-1, 0},
+                                    {0, 0}, {42, 1}, {-5, 2}, {1, 57}};
+    fraction out[11];
+    unsigned long long seed = 777;
+    mpz_t n, d;
+    int i;
+
+    rational_best_batch(in, out, 11, 57);
+    for (i = 0; i < 11; ++i)
+    {
+        ASSERT( out[i].n == want[i].n && out[i].d == want[i].d );
+    }
+
+    /* ties as rational_best_with_bound(): k + 1/2 gives k, for -x too */
+    for (i = -4; i <= 4; ++i)
+    {
+        double x = i + (i < 0 ? -0.5 : 0.5);
+        fraction f, g;
+        cf * c;
+
+        rational_best_batch(&x, &f, 1, 1);
+        ASSERT( f.n == i && f.d == 1 );
+        c = cf_create_from_fraction((fraction){2 * i + (i < 0 ? -1 : 1), 2});
+        g = rational_best_with_bound(c, 1, LLONG_MAX);
+        ASSERT( f.n == g.n && f.d == g.d );
+        cf_free(c);
+    }
+    for (i = -40; i <= 40; ++i)
+    {
+        long long maxden;
+
+        for (maxden = 1; maxden <= 4; ++maxden)
+        {
+            double x = i / 8.0;
+            fraction f, g;
+            cf * c;
+
+            rational_best_batch(&x, &f, 1, maxden);
+            c = cf_create_from_fraction((fraction){i, 8});
+            g = rational_best_with_bound(c, maxden, LLONG_MAX);
+            ASSERT( f.n == g.n && f.d == g.d );
+            cf_free(c);
+        }
+    }
+
+    /* the same as rational_best_with_bound() of the exact values */
+    mpz_inits(n, d, NULL);
+    for (i = 0; i < 20000; ++i)
+    {
+        long long maxden;
+        double x;
+        fraction f;
+        cf * c;
+        int e;
+
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        x = ldexp((double)(seed >> 11) / 9007199254740992.0, (int)(seed % 60) - 20);
+        if (seed & 1024)
+            x = -x;
+        maxden = i % 2 ? (long long)(seed >> 40) % 1000 + 1
+                       : (long long)(seed >> 20) % 1000000000000ll + 1;
+        rational_best_batch(&x, &f, 1, maxden);
+
+        mpz_set_d(n, ldexp(frexp(x, &e), 53));
+        mpz_set_ui(d, 1u);
+        if (e > 53)
+            mpz_mul_2exp(n, n, e - 53);
+        else
+            mpz_mul_2exp(d, d, 53 - e);
+        c = cf_create_from_mpz_fraction(n, d);
+        out[0] = rational_best_with_bound(c, maxden, LLONG_MAX);
+        cf_free(c);
+        if (f.n != out[0].n || f.d != out[0].d)
+            printf("  %.17g maxden %lld: %lld/%lld, not %lld/%lld\n",
+                   x, maxden, f.n, f.d, out[0].n, out[0].d);
+        ASSERT( f.n == out[0].n && f.d == out[0].d );
+    }
+    mpz_clears(n, d, NULL);
+    return 0;
+}
+
 int main(void)
 {
     TEST( arithmatics );
@@ -855,6 +2392,28 @@ int main(void)
     TEST( canonical_float_string );
     TEST( float_string_add );
     TEST( best_rational_in_interval );
+    TEST( bihomo_pre );
+    TEST( next_terms );
+    TEST( homographic_wide );
+    TEST( bihomographic_adaptive );
+    TEST( integer_small );
+    TEST( mpz_fraction );
+    TEST( sqrt_period );
+    TEST( quadratic );
+    TEST( pi_chudnovsky );
+    TEST( digit_chunks );
+    TEST( string_float_bulk );
+    TEST( write_float );
+    TEST( term_file );
+    TEST( terms_shared );
+    TEST( shared_copies );
+    TEST( memo );
+    TEST( digit_gen_copy );
+    TEST( converg_mpz );
+    TEST( convergent_at );
+    TEST( convergents_scan );
+    TEST( best_with_bound );
+    TEST( best_batch );
 
     return 0;
 }